@@ -4,8 +4,8 @@
  * @file     hanoi.cpp
  * @brief    这个文件用于本人学习数据结构与算法
  *
- * 该文件写的是使用递归解决hanoi问题
- * 最近修改日期：2023-01-03
+ * 该文件写的是使用递归解决hanoi问题，以及不用递归直接算出第k步的迭代写法
+ * 最近修改日期：2026-10-18
  *
  * @author   Zhou Junping
  * @email    zhoujunpingnn@gmail.com
@@ -16,12 +16,28 @@
 
 #include <iostream>
 #include <string>
+#include <cstdint>
+#include <cstddef>
 
 using namespace std;
 
-void hanoi(int num, string from, string to, string other);
+/**
+ * 一步移动：把编号为disk的盘子从from柱移到to柱
+ * 盘子编号从1开始，最小的盘子为1；柱子编号0为起始柱，1为辅助柱，2为目标柱
+ */
+struct HanoiMove {
+    uint8_t disk;
+    uint8_t from;
+    uint8_t to;
+};
+
+void hanoi(int num, const string& from, const string& to, const string& other);
+uint64_t hanoi_move_count(int num);
+HanoiMove hanoi_move(int num, uint64_t k);
+size_t hanoi_moves(int num, uint64_t first, HanoiMove* buffer, size_t count);
+void hanoi_state(int num, uint64_t k, uint8_t* peg_of_disk);
 
-void hanoi(int num, string from, string to, string other) {
+void hanoi(int num, const string& from, const string& to, const string& other) {
     //num代表要移动的盘子个数，（其实在递归中也代表编号：底部最大，最小的盘子为1，但是这样不易于理解递归）
     if (num == 0) {//当没有盘子可移动时，递归终止
         return;
@@ -32,7 +48,98 @@ void hanoi(int num, string from, string to, string other) {
     hanoi(num - 1, other, to, from);//将前num-1个盘子从other移到to上
 }
 
+/*************************迭代、可随机访问的hanoi*************************
+ * 递归的写法只能从头到尾打印一遍，盘子多了以后没法用，也没法直接跳到中间某一步
+ * 把移动从1开始编号，num个盘子一共2^num - 1步，观察递归展开的结果可以发现：
+ *      1）第k步移动的盘子是k的二进制末尾0的个数加一（k = 2^(d-1) * 奇数时移动盘子d）
+ *      2）盘子d第一次在第2^(d-1)步移动，以后每隔2^d步移动一次，所以前k步中盘子d移动了
+ *         floor((k + 2^(d-1)) / 2^d) = (k >> d) + (k的第d-1位)次
+ *      3）每个盘子总是朝同一个方向循环移动：num - d为偶数的盘子按0->2->1->0，为奇数的盘子按0->1->2->0
+ * 所以第k步和第k步之后每个盘子的位置都可以直接算出来，不需要递归也不需要申请内存
+ * num最大为64，此时一共2^64 - 1步，k用uint64_t表示
+ */
+
+//num个盘子一共要移动的步数
+uint64_t hanoi_move_count(int num) {
+    return num >= 64 ? UINT64_MAX : ((uint64_t)1 << num) - 1;
+}
+
+//k的二进制末尾0的个数（k不为0）
+inline int hanoi_trailing_zeros(uint64_t k) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(k);
+#else
+    int count = 0;
+    while ((k & 1) == 0) {
+        k >>= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+//前k步中盘子disk移动的次数
+inline uint64_t hanoi_disk_moves(int disk, uint64_t k) {
+    uint64_t full = disk >= 64 ? 0 : k >> disk;
+    return full + ((k >> (disk - 1)) & 1);
+}
+
+//盘子disk移动了moves次之后所在的柱子
+inline uint8_t hanoi_disk_peg(int num, int disk, uint64_t moves) {
+    uint64_t step = (num - disk) % 2 == 0 ? 2 : 1;//往前走两格相当于往回走一格
+    return (uint8_t)(step * (moves % 3) % 3);
+}
+
+//第k步（1 <= k <= hanoi_move_count(num)）
+HanoiMove hanoi_move(int num, uint64_t k) {
+    HanoiMove move;
+    int disk = hanoi_trailing_zeros(k) + 1;
+    uint64_t moves = hanoi_disk_moves(disk, k);
+    move.disk = (uint8_t)disk;
+    move.from = hanoi_disk_peg(num, disk, moves - 1);
+    move.to = hanoi_disk_peg(num, disk, moves);
+    return move;
+}
+
+//从第first步开始连续的count步写进buffer，超过总步数的部分不写，返回写入的步数
+size_t hanoi_moves(int num, uint64_t first, HanoiMove* buffer, size_t count) {
+    uint64_t total = hanoi_move_count(num);
+    if (first == 0 || first > total) {
+        return 0;
+    }
+    if (count > total - first + 1) {
+        count = (size_t)(total - first + 1);
+    }
+    for (size_t i = 0; i < count; i++) {
+        buffer[i] = hanoi_move(num, first + i);
+    }
+    return count;
+}
+
+//前k步移动完之后每个盘子所在的柱子，peg_of_disk[d - 1]为盘子d所在的柱子
+void hanoi_state(int num, uint64_t k, uint8_t* peg_of_disk) {
+    for (int disk = 1; disk <= num; disk++) {
+        peg_of_disk[disk - 1] = hanoi_disk_peg(num, disk, hanoi_disk_moves(disk, k));
+    }
+}
+
 int main() {
     hanoi(3, "left", "right", "middle");
+
+    //同样的3个盘子用迭代的方法生成
+    const string names[3] = {"left", "middle", "right"};
+    HanoiMove moves[7];
+    size_t count = hanoi_moves(3, 1, moves, 7);
+    for (size_t i = 0; i < count; i++) {
+        cout<<"move "<<(int)moves[i].disk<<" from "<<names[moves[i].from]<<" to "<<names[moves[i].to]<<endl;
+    }
+
+    //64个盘子，直接跳到中间某一步
+    uint64_t k = 1234567890123456789ull;
+    HanoiMove move = hanoi_move(64, k);
+    cout<<"64 disks, move "<<k<<": disk "<<(int)move.disk<<" from "<<names[move.from]<<" to "<<names[move.to]<<endl;
+    uint8_t pegs[64];
+    hanoi_state(64, k, pegs);
+    cout<<"after that, disk 1 is on "<<names[pegs[0]]<<", disk 64 is on "<<names[pegs[63]]<<endl;
     return 0;
 }
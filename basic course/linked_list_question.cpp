@@ -8,7 +8,10 @@
  * 2.将一个链表小于某个数的放头部，等于某个数的放中间，大于某个数的放尾部
  * 3.使用空间复杂度O(1)，复制一份rand链表
  * 4.判断两个链表（分别有环或无环）是否相交，是则返回第一个相交节点，否则返回null
- * 最近修改日期：2022-10-19
+ * 5.节点放在连续数组池中、用32位下标连接的链表，以及以上各题在这种链表上的实现
+ * 6.展开链表（每个节点存一个小数组），支持O(1)拼接和稳定划分
+ * 7.把rand链表整体复制到一块连续内存中（可多线程），以及AVX2的内存比较
+ * 最近修改日期：2026-10-18
  *
  * @author   Zhou Junping
  * @email    zhoujunpingnn@gmail.com
@@ -18,6 +21,26 @@
  */
 #include<iostream>
 #include<cstdio>
+#include<cstdlib>
+#include<cstdint>
+#include<cstddef>
+#include<vector>
+#include<list>
+#include<iterator>
+#include<algorithm>
+#include<random>
+#include<chrono>
+#include<string>
+#include<stdexcept>
+#include<cstring>
+#include<new>
+#include<thread>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LIST_HAS_AVX2_KERNEL 1
+#include<immintrin.h>
+#else
+#define LIST_HAS_AVX2_KERNEL 0
+#endif
 
 using namespace std;
 
@@ -48,10 +71,14 @@ bool question1(ListNode* head);//判断一个链表是否是回文结构
 ListNode* question2(ListNode* head, int value);//将一个链表小于某个数的放头部，等于某个数的放中间，大于某个数的放尾部
 randListNode* question3(randListNode* head);//使用空间复杂度O(1)，复制一份rand链表
 int Buffercmp(void* Tx_Buffer, void* Rx_Buffer, int Num);
+size_t buffer_mismatch(const void* a, const void* b, size_t len);//返回两块内存第一个不同的字节的偏移，完全相同时返回len
 ListNode* is_Loop(ListNode* head);//判断一个链表是否有环
 ListNode* no_Loop(ListNode* head1, ListNode* head2);//判断两个无环链表是否相交，是则返回第一个相交节点，否则返回null
 ListNode* Loop(ListNode* head1, ListNode* head2, ListNode* node1, ListNode* node2);//判断两个有环链表是否相交，是则返回第一个相交点，否则返回null
 ListNode* question4(ListNode* head1, ListNode* head2);//判断两个链表（分别有环或无环）是否相交，是则返回第一个相交节点，否则返回null
+void benchmark_list_pool(size_t len);//比较new出来的链表和数组池中的链表
+void benchmark_unrolled_list(size_t len);//比较std::list、展开链表和vector
+void benchmark_rand_list_clone(size_t len);//比较question3和批量复制rand链表，以及逐字节和向量化的内存比较
 
 //判断一个链表是否是回文结构，空间复杂度为O(1)，使用判断指针
 bool question1(ListNode* head){
@@ -222,16 +249,15 @@ randListNode* question3(randListNode* head){
 //数据对比
 int Buffercmp(void* Tx_Buffer, void* Rx_Buffer, int Num)
 {
-    int i=0;
-    for(i=0;i<Num;i++)
+    if(Num <= 0)
     {
-        if(*((char*)Tx_Buffer) != *((char*)Rx_Buffer))
-        {
-            printf("\n%d ",i);
-            return 0;
-        }
-        Tx_Buffer = (char*)Tx_Buffer + 1;
-        Rx_Buffer = (char*)Rx_Buffer + 1;
+        return 1;
+    }
+    size_t i = buffer_mismatch(Tx_Buffer, Rx_Buffer, (size_t)Num);
+    if(i != (size_t)Num)
+    {
+        printf("\n%d ",(int)i);
+        return 0;
     }
     return 1;
 }
@@ -361,7 +387,940 @@ ListNode* question4(ListNode* head1, ListNode* head2){
     }
 }
 
-int main(){
+/*************************数组池中的链表*************************
+ * 上面的链表每个节点都是单独new出来的，长时间运行以后节点散落在堆的各个地方，遍历时几乎每一步都是一次缓存未命中，
+ * 并且64位的指针加上malloc的头部，一个只存了一个int的节点要占32字节
+ * 这里把节点放在一块连续的数组（池）里，用32位的下标代替指针，一个节点只有8字节（带rand的节点12字节）：
+ *      1）从数组批量建链表时，相邻的节点在内存中也是相邻的，顺序遍历可以被硬件预取
+ *      2）下标在池扩容以后仍然有效，整个池可以直接拷贝
+ * 上面的回文判断、荷兰国旗划分、rand链表复制、环和相交的判断都按下标重写了一遍，思路与原来完全相同
+ * 链表用头节点的下标表示，LIST_NIL表示空（相当于nullptr）
+ */
+const uint32_t LIST_NIL = UINT32_MAX;
+
+class ListPool{
+public:
+    struct Node{
+        int value;
+        uint32_t next;
+    };
+
+    //沿着next遍历链表的前向迭代器
+    class iterator{
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef int value_type;
+        typedef ptrdiff_t difference_type;
+        typedef int* pointer;
+        typedef int& reference;
+
+        iterator(ListPool* pool, uint32_t index) : pool(pool), index(index) {}
+        int& operator*() const { return pool->nodes[index].value; }
+        iterator& operator++(){
+            index = pool->nodes[index].next;
+            return *this;
+        }
+        iterator operator++(int){
+            iterator old = *this;
+            ++*this;
+            return old;
+        }
+        bool operator==(const iterator& other) const { return index == other.index; }
+        bool operator!=(const iterator& other) const { return index != other.index; }
+        uint32_t position() const { return index; }
+    private:
+        ListPool* pool;
+        uint32_t index;
+    };
+
+    struct Range{
+        iterator first;
+        iterator last;
+        iterator begin() const { return first; }
+        iterator end() const { return last; }
+    };
+
+    explicit ListPool(size_t capacity = 0){
+        nodes.reserve(capacity);
+    }
+
+    //新建一个节点，返回它的下标
+    uint32_t allocate(int value, uint32_t next = LIST_NIL){
+        if(nodes.size() >= LIST_NIL){
+            throw length_error("ListPool: too many nodes");
+        }
+        Node node = {value, next};
+        nodes.push_back(node);
+        return (uint32_t)(nodes.size() - 1);
+    }
+
+    //用数组批量建一条链表，节点在池中连续存放，返回头节点（len为0时返回LIST_NIL）
+    uint32_t build(const int* values, size_t len){
+        if(len == 0){
+            return LIST_NIL;
+        }
+        if(nodes.size() + len >= LIST_NIL){
+            throw length_error("ListPool: too many nodes");
+        }
+        uint32_t head = (uint32_t)nodes.size();
+        nodes.resize(nodes.size() + len);
+        for(size_t i = 0; i < len; i++){
+            nodes[head + i].value = values[i];
+            nodes[head + i].next = i + 1 < len ? (uint32_t)(head + i + 1) : LIST_NIL;
+        }
+        return head;
+    }
+
+    Node& operator[](uint32_t index){ return nodes[index]; }
+    const Node& operator[](uint32_t index) const { return nodes[index]; }
+    size_t size() const { return nodes.size(); }
+
+    Range list(uint32_t head){
+        Range range = {iterator(this, head), iterator(this, LIST_NIL)};
+        return range;
+    }
+
+private:
+    vector<Node> nodes;
+};
+
+//带rand指针的链表节点池
+class RandListPool{
+public:
+    struct Node{
+        int value;
+        uint32_t next;
+        uint32_t rand;
+    };
+
+    uint32_t allocate(int value){
+        if(nodes.size() >= LIST_NIL){
+            throw length_error("RandListPool: too many nodes");
+        }
+        Node node = {value, LIST_NIL, LIST_NIL};
+        nodes.push_back(node);
+        return (uint32_t)(nodes.size() - 1);
+    }
+
+    //批量建链表，rand[i]为第i个节点的rand指向的节点在values中的位置（LIST_NIL表示空），rand[i]超出[0, len)时抛出out_of_range
+    uint32_t build(const int* values, const uint32_t* rand, size_t len){
+        if(len == 0){
+            return LIST_NIL;
+        }
+        if(nodes.size() + len >= LIST_NIL){
+            throw length_error("RandListPool: too many nodes");
+        }
+        for(size_t i = 0; i < len; i++){//先检查完再建，出错时池不变
+            if(rand[i] != LIST_NIL && rand[i] >= len){
+                throw out_of_range("RandListPool: rand index out of range");
+            }
+        }
+        uint32_t head = (uint32_t)nodes.size();
+        nodes.resize(nodes.size() + len);
+        for(size_t i = 0; i < len; i++){
+            nodes[head + i].value = values[i];
+            nodes[head + i].next = i + 1 < len ? (uint32_t)(head + i + 1) : LIST_NIL;
+            nodes[head + i].rand = rand[i] == LIST_NIL ? LIST_NIL : head + rand[i];
+        }
+        return head;
+    }
+
+    Node& operator[](uint32_t index){ return nodes[index]; }
+    const Node& operator[](uint32_t index) const { return nodes[index]; }
+    size_t size() const { return nodes.size(); }
+    void reserve(size_t capacity){ nodes.reserve(capacity); }
+
+private:
+    vector<Node> nodes;
+};
+
+//把从head开始的链表反转，返回新的头节点
+uint32_t pool_reverse(ListPool& pool, uint32_t head){
+    uint32_t prev = LIST_NIL;
+    while(head != LIST_NIL){
+        uint32_t next = pool[head].next;
+        pool[head].next = prev;
+        prev = head;
+        head = next;
+    }
+    return prev;
+}
+
+//question1：判断是否回文，右半部分反转后比较，比较完（无论结果如何）都把链表还原；空链表和只有一个节点的链表算回文
+bool pool_is_palindrome(ListPool& pool, uint32_t head){
+    if(head == LIST_NIL || pool[head].next == LIST_NIL){
+        return true;
+    }
+    uint32_t slow = head;
+    uint32_t quick = head;
+    while(pool[quick].next != LIST_NIL && pool[pool[quick].next].next != LIST_NIL){//循环结束后，slow在链表的中心节点
+        slow = pool[slow].next;
+        quick = pool[pool[quick].next].next;
+    }
+    uint32_t right = pool_reverse(pool, pool[slow].next);
+    pool[slow].next = LIST_NIL;
+    bool res = true;
+    for(uint32_t n1 = right, n2 = head; n1 != LIST_NIL; n1 = pool[n1].next, n2 = pool[n2].next){
+        if(pool[n1].value != pool[n2].value){
+            res = false;
+            break;
+        }
+    }
+    pool[slow].next = pool_reverse(pool, right);//还原链表
+    return res;
+}
+
+//question2：小于value的放头部，等于的放中间，大于的放尾部（各部分内部保持原来的顺序），返回新的头节点
+uint32_t pool_partition(ListPool& pool, uint32_t head, int value){
+    uint32_t heads[3] = {LIST_NIL, LIST_NIL, LIST_NIL};//小于、等于、大于三段的头和尾
+    uint32_t tails[3] = {LIST_NIL, LIST_NIL, LIST_NIL};
+    for(uint32_t iter = head; iter != LIST_NIL; iter = pool[iter].next){
+        int part = pool[iter].value < value ? 0 : (pool[iter].value == value ? 1 : 2);
+        if(heads[part] == LIST_NIL){
+            heads[part] = iter;
+        }else{
+            pool[tails[part]].next = iter;
+        }
+        tails[part] = iter;
+    }
+    uint32_t res = LIST_NIL;
+    uint32_t tail = LIST_NIL;
+    for(int part = 0; part < 3; part++){//三段依次连起来，跳过空的段
+        if(heads[part] == LIST_NIL){
+            continue;
+        }
+        if(res == LIST_NIL){
+            res = heads[part];
+        }else{
+            pool[tail].next = heads[part];
+        }
+        tail = tails[part];
+    }
+    if(tail != LIST_NIL){
+        pool[tail].next = LIST_NIL;
+    }
+    return res;
+}
+
+//question3：复制rand链表，每个节点的复制品先串在它和下一个节点之间，复制品分配在同一个池里
+uint32_t pool_copy_rand_list(RandListPool& pool, uint32_t head){
+    if(head == LIST_NIL){
+        return LIST_NIL;
+    }
+    for(uint32_t iter = head; iter != LIST_NIL; ){
+        uint32_t copy = pool.allocate(pool[iter].value);
+        uint32_t next = pool[iter].next;
+        pool[iter].next = copy;
+        pool[copy].next = next;
+        iter = next;
+    }
+    for(uint32_t src = head; src != LIST_NIL; src = pool[pool[src].next].next){//复制rand
+        uint32_t rand = pool[src].rand;
+        pool[pool[src].next].rand = rand == LIST_NIL ? LIST_NIL : pool[rand].next;
+    }
+    uint32_t res = pool[head].next;
+    for(uint32_t src = head; src != LIST_NIL; ){//拆开两个链表
+        uint32_t dst = pool[src].next;
+        uint32_t next = pool[dst].next;
+        pool[src].next = next;
+        pool[dst].next = next == LIST_NIL ? LIST_NIL : pool[next].next;
+        src = next;
+    }
+    return res;
+}
+
+//is_Loop：有环时返回第一个入环节点，否则返回LIST_NIL
+uint32_t pool_find_loop(const ListPool& pool, uint32_t head){
+    if(head == LIST_NIL || pool[head].next == LIST_NIL){
+        return LIST_NIL;
+    }
+    uint32_t slow = pool[head].next;
+    uint32_t quick = pool[slow].next;
+    while(quick != slow){
+        if(quick == LIST_NIL || pool[quick].next == LIST_NIL){
+            return LIST_NIL;
+        }
+        slow = pool[slow].next;
+        quick = pool[pool[quick].next].next;
+    }
+    quick = head;
+    while(quick != slow){
+        quick = pool[quick].next;
+        slow = pool[slow].next;
+    }
+    return quick;
+}
+
+//从head走到stop之前的最后一个节点，返回走过的步数
+uint32_t pool_last_before(const ListPool& pool, uint32_t head, uint32_t stop, int64_t& steps){
+    steps = 0;
+    while(pool[head].next != stop){
+        head = pool[head].next;
+        steps++;
+    }
+    return head;
+}
+
+//no_Loop和Loop的第一种情况：两条链表在stop之前相交，长的先走差数步，再一起走到相遇
+uint32_t pool_meet_before(const ListPool& pool, uint32_t head1, uint32_t head2, uint32_t stop){
+    int64_t len1, len2;
+    uint32_t end1 = pool_last_before(pool, head1, stop, len1);
+    uint32_t end2 = pool_last_before(pool, head2, stop, len2);
+    if(end1 != end2){
+        return LIST_NIL;
+    }
+    for(; len1 > len2; len1--){
+        head1 = pool[head1].next;
+    }
+    for(; len2 > len1; len2--){
+        head2 = pool[head2].next;
+    }
+    while(head1 != head2){
+        head1 = pool[head1].next;
+        head2 = pool[head2].next;
+    }
+    return head1;
+}
+
+//question4：两条链表（分别有环或无环）相交时返回第一个相交节点，否则返回LIST_NIL
+uint32_t pool_intersect(const ListPool& pool, uint32_t head1, uint32_t head2){
+    if(head1 == LIST_NIL || head2 == LIST_NIL){
+        return LIST_NIL;
+    }
+    uint32_t loop1 = pool_find_loop(pool, head1);
+    uint32_t loop2 = pool_find_loop(pool, head2);
+    if((loop1 == LIST_NIL) != (loop2 == LIST_NIL)){//一个有环一个无环不可能相交
+        return LIST_NIL;
+    }
+    if(loop1 == LIST_NIL){
+        return pool_meet_before(pool, head1, head2, LIST_NIL);
+    }
+    if(loop1 == loop2){//入环节点相同：在入环之前（或入环节点处）相交
+        if(head1 == loop1 || head2 == loop1){
+            return loop1;
+        }
+        uint32_t meet = pool_meet_before(pool, head1, head2, loop1);
+        return meet == LIST_NIL ? loop1 : meet;
+    }
+    for(uint32_t cur = pool[loop1].next; cur != loop1; cur = pool[cur].next){//入环节点不同：看loop2是否在loop1的环上
+        if(cur == loop2){
+            return loop2;
+        }
+    }
+    return LIST_NIL;
+}
+
+//10M个节点：new出来的链表按随机顺序串起来（模拟长时间运行后节点散落在堆上），池中的链表批量建立
+void benchmark_list_pool(size_t len){
+    mt19937_64 rng(3);
+    vector<int> values(len);
+    for(size_t i = 0; i < len; i++){
+        values[i] = (int)min(i, len - 1 - i) % 1000;//回文，判断时要走完整条链表
+    }
+    vector<ListNode*> allocated(len);
+    for(size_t i = 0; i < len; i++){
+        allocated[i] = new ListNode(0);
+    }
+    vector<ListNode*> order(allocated);
+    shuffle(order.begin(), order.end(), rng);
+    for(size_t i = 0; i < len; i++){
+        order[i]->value = values[i];
+        order[i]->next = i + 1 < len ? order[i + 1] : nullptr;
+    }
+    ListNode* head = order[0];
+
+    ListPool pool(len);
+    uint32_t pool_head = pool.build(values.data(), len);
+
+    auto seconds = [](chrono::steady_clock::time_point start){
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count() * 1e9;
+    };
+    cout<<"len = "<<len<<" (ns/node)"<<endl;
+
+    auto start = chrono::steady_clock::now();
+    bool res1 = question1(head);
+    double pointer_time = seconds(start);
+    start = chrono::steady_clock::now();
+    bool res2 = pool_is_palindrome(pool, pool_head);
+    cout<<"palindrome: pointer "<<pointer_time / len<<", pool "<<seconds(start) / len<<(res1 == res2 ? "" : " (wrong)")<<endl;
+
+    start = chrono::steady_clock::now();
+    ListNode* found1 = is_Loop(head);
+    pointer_time = seconds(start);
+    start = chrono::steady_clock::now();
+    uint32_t found2 = pool_find_loop(pool, pool_head);
+    cout<<"loop detection: pointer "<<pointer_time / len<<", pool "<<seconds(start) / len
+        <<((found1 == nullptr) == (found2 == LIST_NIL) ? "" : " (wrong)")<<endl;
+
+    start = chrono::steady_clock::now();
+    head = question2(head, 500);
+    pointer_time = seconds(start);
+    start = chrono::steady_clock::now();
+    pool_head = pool_partition(pool, pool_head, 500);
+    double pool_time = seconds(start);
+    uint64_t sum1 = 0, sum2 = 0;//无符号数溢出是按模回绕，不是未定义行为
+    for(ListNode* iter = head; iter != nullptr; iter = iter->next){
+        sum1 = sum1 * 31 + (uint64_t)iter->value;
+    }
+    for(int value : pool.list(pool_head)){
+        sum2 = sum2 * 31 + (uint64_t)value;
+    }
+    cout<<"partition: pointer "<<pointer_time / len<<", pool "<<pool_time / len<<(sum1 == sum2 ? "" : " (wrong)")<<endl;
+
+    for(ListNode* node : allocated){
+        delete node;
+    }
+}
+
+/*************************展开链表（unrolled linked list）*************************
+ * 链表的插入、删除、拼接都是O(1)，但每个节点只存一个数，遍历时每一步都要跳一次指针；数组遍历快，但中间插入要搬动后面所有的数
+ * 展开链表的每个节点存一个小数组（NodeBytes字节，默认256字节，即4个缓存行），节点之间用双向链表连起来：
+ *      1）遍历时大部分时间是在节点内顺序读数组，每NodeBytes字节才跳一次指针
+ *      2）插入时节点满了就从中间分裂成两个节点，删除后节点太空（不足1/4）并且能和后一个节点装进一个节点就合并，
+ *         所以插入、删除只搬动一个节点内的数，是O(NodeBytes)的常数
+ *      3）把另一条链表整个拼接进来时，只需要在插入位置把节点分裂一次，再改几个指针，是O(1)
+ * question2的荷兰国旗划分在这里写成稳定的划分：按顺序把每个数追加到小于、等于、大于三条链表的末尾
+ * （一边追加一边释放原来的节点），最后三条链表拼接起来，每部分内部保持原来的顺序
+ * 插入、删除以后，指向被改动的节点中的元素的迭代器失效
+ */
+template<typename T, size_t NodeBytes = 256>
+class UnrolledList{
+    struct NodeHeader{
+        void* prev;
+        void* next;
+        uint32_t count;
+    };
+public:
+    static const uint32_t CAPACITY = (NodeBytes - sizeof(NodeHeader)) / sizeof(T) >= 2 ? (uint32_t)((NodeBytes - sizeof(NodeHeader)) / sizeof(T)) : 2;
+
+private:
+    struct Node{
+        Node* prev;
+        Node* next;
+        uint32_t count;
+        T items[CAPACITY];
+        Node() : prev(nullptr), next(nullptr), count(0) {}
+    };
+
+public:
+    class iterator{
+    public:
+        typedef forward_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef ptrdiff_t difference_type;
+        typedef T* pointer;
+        typedef T& reference;
+
+        iterator() : node(nullptr), index(0) {}
+        iterator(Node* node, uint32_t index) : node(node), index(index) {}
+        T& operator*() const { return node->items[index]; }
+        T* operator->() const { return &node->items[index]; }
+        iterator& operator++(){
+            if(++index == node->count){
+                node = node->next;
+                index = 0;
+            }
+            return *this;
+        }
+        iterator operator++(int){
+            iterator old = *this;
+            ++*this;
+            return old;
+        }
+        bool operator==(const iterator& other) const { return node == other.node && index == other.index; }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+    private:
+        Node* node;
+        uint32_t index;
+        friend class UnrolledList;
+    };
+
+    UnrolledList() : head(nullptr), tail(nullptr), count(0) {}
+    ~UnrolledList(){ clear(); }
+    UnrolledList(const UnrolledList&) = delete;
+    UnrolledList& operator=(const UnrolledList&) = delete;
+    UnrolledList(UnrolledList&& other) : head(other.head), tail(other.tail), count(other.count) {
+        other.head = other.tail = nullptr;
+        other.count = 0;
+    }
+    UnrolledList& operator=(UnrolledList&& other){
+        swap(other);
+        return *this;
+    }
+
+    void swap(UnrolledList& other){
+        std::swap(head, other.head);
+        std::swap(tail, other.tail);
+        std::swap(count, other.count);
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    iterator begin() const { return iterator(head, 0); }
+    iterator end() const { return iterator(); }
+
+    void clear(){
+        while(head != nullptr){
+            Node* next = head->next;
+            delete head;
+            head = next;
+        }
+        tail = nullptr;
+        count = 0;
+    }
+
+    void push_back(const T& value){
+        if(tail == nullptr || tail->count == CAPACITY){
+            link_after(tail, new Node());
+        }
+        tail->items[tail->count++] = value;
+        count++;
+    }
+
+    void push_front(const T& value){
+        insert(begin(), value);
+    }
+
+    //在pos之前插入value，返回指向value的迭代器
+    iterator insert(iterator pos, const T& value){
+        if(pos.node == nullptr){
+            push_back(value);
+            return iterator(tail, tail->count - 1);
+        }
+        Node* node = pos.node;
+        uint32_t index = pos.index;
+        if(node->count == CAPACITY){//节点满了，从中间分裂
+            Node* right = split(node, CAPACITY / 2);
+            if(index > CAPACITY / 2){
+                node = right;
+                index -= CAPACITY / 2;
+            }
+        }
+        std::move_backward(node->items + index, node->items + node->count, node->items + node->count + 1);
+        node->items[index] = value;
+        node->count++;
+        count++;
+        return iterator(node, index);
+    }
+
+    //删除pos，返回下一个元素的迭代器
+    iterator erase(iterator pos){
+        Node* node = pos.node;
+        uint32_t index = pos.index;
+        std::move(node->items + index + 1, node->items + node->count, node->items + index);
+        node->count--;
+        count--;
+        if(node->count == 0){
+            Node* next = node->next;
+            unlink(node);
+            return iterator(next, 0);
+        }
+        Node* next = node->next;
+        if(node->count < CAPACITY / 4 && next != nullptr && node->count + next->count <= CAPACITY){//太空了，和后一个节点合并
+            std::move(next->items, next->items + next->count, node->items + node->count);
+            node->count += next->count;
+            unlink(next);
+        }
+        if(index == node->count){
+            return iterator(node->next, 0);
+        }
+        return iterator(node, index);
+    }
+
+    //把other整个拼接到pos之前，other变为空
+    void splice(iterator pos, UnrolledList& other){
+        if(&other == this || other.head == nullptr){
+            return;
+        }
+        Node* before;
+        Node* after;
+        if(pos.node == nullptr){
+            before = tail;
+            after = nullptr;
+        }
+        else if(pos.index == 0){
+            before = pos.node->prev;
+            after = pos.node;
+        }
+        else{
+            before = pos.node;
+            after = split(pos.node, pos.index);
+        }
+        other.head->prev = before;
+        other.tail->next = after;
+        (before == nullptr ? head : before->next) = other.head;
+        (after == nullptr ? tail : after->prev) = other.tail;
+        count += other.count;
+        other.head = other.tail = nullptr;
+        other.count = 0;
+    }
+
+    //按顺序把每个元素交给f(T&)，交完一个节点就释放一个节点，最后链表为空
+    template<typename F>
+    void consume(F f){
+        while(head != nullptr){
+            Node* next = head->next;
+            for(uint32_t i = 0; i < head->count; i++){
+                f(head->items[i]);
+            }
+            delete head;
+            head = next;
+        }
+        tail = nullptr;
+        count = 0;
+    }
+
+    //稳定划分：满足pred的元素放在前面，两部分内部都保持原来的顺序，返回第一个不满足pred的元素
+    template<typename Pred>
+    iterator stable_partition(Pred pred){
+        UnrolledList yes, no;
+        consume([&](T& value){
+            (pred(value) ? yes : no).push_back(std::move(value));
+        });
+        iterator second = no.begin();
+        splice(end(), yes);
+        splice(end(), no);
+        return second;
+    }
+
+private:
+    Node* head;
+    Node* tail;
+    size_t count;
+
+    void link_after(Node* before, Node* node){
+        node->prev = before;
+        node->next = before == nullptr ? head : before->next;
+        (node->next == nullptr ? tail : node->next->prev) = node;
+        (before == nullptr ? head : before->next) = node;
+    }
+
+    void unlink(Node* node){
+        (node->prev == nullptr ? head : node->prev->next) = node->next;
+        (node->next == nullptr ? tail : node->next->prev) = node->prev;
+        delete node;
+    }
+
+    //把node中[at, count)的元素移到紧跟在node后面的新节点中，返回新节点
+    Node* split(Node* node, uint32_t at){
+        Node* right = new Node();
+        std::move(node->items + at, node->items + node->count, right->items);
+        right->count = node->count - at;
+        node->count = at;
+        link_after(node, right);
+        return right;
+    }
+};
+
+//question2的稳定版本：小于value的放头部，等于的放中间，大于的放尾部，各部分保持原来的顺序
+void unrolled_partition(UnrolledList<int>& list, int value){
+    UnrolledList<int> parts[3];
+    list.consume([&](int x){
+        parts[x < value ? 0 : (x == value ? 1 : 2)].push_back(x);
+    });
+    for(int part = 0; part < 3; part++){
+        list.splice(list.end(), parts[part]);
+    }
+}
+
+//比较std::list、展开链表和vector的顺序遍历、边遍历边插入、划分
+void benchmark_unrolled_list(size_t len){
+    mt19937_64 rng(5);
+    vector<int> values(len);
+    for(auto& x : values){
+        x = (int)(rng() % 1000);
+    }
+    std::list<int> linked(values.begin(), values.end());
+    UnrolledList<int> unrolled;
+    for(int x : values){
+        unrolled.push_back(x);
+    }
+    auto nanos = [](chrono::steady_clock::time_point start){
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count() * 1e9;
+    };
+    cout<<"len = "<<len<<" (ns/element), unrolled node capacity = "<<UnrolledList<int>::CAPACITY<<endl;
+
+    long long sums[3] = {0, 0, 0};
+    auto start = chrono::steady_clock::now();
+    for(int x : linked){
+        sums[0] += x;
+    }
+    double list_time = nanos(start);
+    start = chrono::steady_clock::now();
+    for(int x : unrolled){
+        sums[1] += x;
+    }
+    double unrolled_time = nanos(start);
+    start = chrono::steady_clock::now();
+    for(int x : values){
+        sums[2] += x;
+    }
+    double vector_time = nanos(start);
+    cout<<"scan: list "<<list_time / len<<", unrolled "<<unrolled_time / len<<", vector "<<vector_time / len
+        <<(sums[0] == sums[1] && sums[1] == sums[2] ? "" : " (wrong)")<<endl;
+
+    //每隔8个元素插入一个数（vector这样插入是O(n^2)的，不参与比较）
+    start = chrono::steady_clock::now();
+    size_t k = 0;
+    for(auto it = linked.begin(); it != linked.end(); ++it){
+        if(++k % 8 == 0){
+            it = linked.insert(it, -1);
+            ++it;
+        }
+    }
+    list_time = nanos(start);
+    start = chrono::steady_clock::now();
+    k = 0;
+    for(auto it = unrolled.begin(); it != unrolled.end(); ++it){
+        if(++k % 8 == 0){
+            it = unrolled.insert(it, -1);
+            ++it;
+        }
+    }
+    unrolled_time = nanos(start);
+    bool same = linked.size() == unrolled.size() && equal(linked.begin(), linked.end(), unrolled.begin());
+    cout<<"insert while scanning: list "<<list_time / len<<", unrolled "<<unrolled_time / len<<(same ? "" : " (wrong)")<<endl;
+
+    start = chrono::steady_clock::now();
+    std::stable_partition(linked.begin(), linked.end(), [](int x){ return x < 500; });
+    list_time = nanos(start);
+    start = chrono::steady_clock::now();
+    unrolled.stable_partition([](int x){ return x < 500; });
+    unrolled_time = nanos(start);
+    start = chrono::steady_clock::now();
+    std::stable_partition(values.begin(), values.end(), [](int x){ return x < 500; });
+    vector_time = nanos(start);
+    same = linked.size() == unrolled.size() && equal(linked.begin(), linked.end(), unrolled.begin());
+    cout<<"stable partition: list "<<list_time / len<<", unrolled "<<unrolled_time / len<<", vector "<<vector_time / len
+        <<(same ? "" : " (wrong)")<<endl;
+}
+
+/*************************批量复制rand链表、向量化的内存比较*************************
+ * question3把复制品串在原节点和下一个节点之间，后面两遍扫描每个节点都要追三次指针，而且每个复制品单独new一次
+ * RandListSnapshot分四步复制：
+ *      1）沿next走一遍，把节点按顺序记在数组nodes里（下标到节点的映射），这是唯一一次串行的追指针
+ *      2）所有复制品一次性分配在一块连续的内存里，第i个节点的复制品就是block[i]，
+ *         再把nodes[i]->next暂时改成指向block[i]，原节点的next就成了节点到复制品的映射
+ *      3）block[i].next就是block + i + 1，block[i].rand是nodes[i]->rand->next，每个i互不相关，可以切段多线程
+ *      4）多线程把原节点的next还原成nodes[i + 1]
+ * 复制品属于整个块，由RandListSnapshot统一释放，不能单独delete；rand必须指向同一条链表里的节点（或者为空）
+ * buffer_mismatch返回两块内存第一个不同的字节的偏移（完全相同时返回len），
+ * AVX2每次比较64字节，用movemask得到相等的字节的掩码，取反以后最低的1就是第一个不同的字节
+ */
+const size_t LIST_PARALLEL_MIN = 1 << 16;//每个线程至少处理这么多个节点
+
+inline bool list_has_avx2(){
+#if LIST_HAS_AVX2_KERNEL
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+//把[0, len)切成几段，每段交给一个线程执行f(begin, end)
+template<typename F>
+void list_parallel_for(size_t len, unsigned thread_num, F f){
+    if(thread_num == 0){
+        thread_num = max(thread::hardware_concurrency(), 1u);
+    }
+    size_t chunk_num = min<size_t>(thread_num, max<size_t>(len / LIST_PARALLEL_MIN, 1));
+    if(chunk_num <= 1){
+        f((size_t)0, len);
+        return;
+    }
+    size_t chunk_len = (len + chunk_num - 1) / chunk_num;
+    vector<thread> workers;
+    for(size_t begin = 0; begin < len; begin += chunk_len){
+        workers.emplace_back(f, begin, min(len, begin + chunk_len));
+    }
+    for(thread& worker : workers){
+        worker.join();
+    }
+}
+
+class RandListSnapshot{
+public:
+    RandListSnapshot() : block(nullptr), count(0) {}
+    explicit RandListSnapshot(randListNode* head, unsigned thread_num = 0) : block(nullptr), count(0) {
+        assign(head, thread_num);
+    }
+    ~RandListSnapshot(){ release(); }
+    RandListSnapshot(const RandListSnapshot&) = delete;
+    RandListSnapshot& operator=(const RandListSnapshot&) = delete;
+
+    randListNode* head() const { return count == 0 ? nullptr : block; }
+    size_t size() const { return count; }
+
+    //复制以head开头的rand链表，原来的复制品被释放
+    void assign(randListNode* head, unsigned thread_num = 0){
+        release();
+        vector<randListNode*> nodes;
+        for(randListNode* iter = head; iter != nullptr; iter = iter->next){
+            nodes.push_back(iter);
+        }
+        size_t len = nodes.size();
+        if(len == 0){
+            return;
+        }
+        block = static_cast<randListNode*>(::operator new(len * sizeof(randListNode)));
+        count = len;
+        randListNode* clones = block;
+        randListNode* const* originals = nodes.data();
+        list_parallel_for(len, thread_num, [=](size_t begin, size_t end){
+            for(size_t i = begin; i < end; i++){
+                new (clones + i) randListNode(originals[i]->value);
+                originals[i]->next = clones + i;
+            }
+        });
+        list_parallel_for(len, thread_num, [=](size_t begin, size_t end){
+            for(size_t i = begin; i < end; i++){
+                randListNode* rand = originals[i]->rand;
+                clones[i].next = i + 1 < len ? clones + i + 1 : nullptr;
+                clones[i].rand = rand == nullptr ? nullptr : rand->next;
+            }
+        });
+        list_parallel_for(len, thread_num, [=](size_t begin, size_t end){
+            for(size_t i = begin; i < end; i++){
+                originals[i]->next = i + 1 < len ? originals[i + 1] : nullptr;
+            }
+        });
+    }
+
+private:
+    randListNode* block;
+    size_t count;
+
+    void release(){
+        ::operator delete(block);
+        block = nullptr;
+        count = 0;
+    }
+};
+
+size_t buffer_mismatch_scalar(const unsigned char* a, const unsigned char* b, size_t len){
+    size_t i = 0;
+    for(; i + 8 <= len; i += 8){//每次比较8个字节，不同时再逐个找
+        uint64_t x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        if(x != y){
+            break;
+        }
+    }
+    while(i < len && a[i] == b[i]){
+        i++;
+    }
+    return i;
+}
+
+#if LIST_HAS_AVX2_KERNEL
+__attribute__((target("avx2"))) size_t buffer_mismatch_avx2(const unsigned char* a, const unsigned char* b, size_t len){
+    size_t i = 0;
+    for(; i + 64 <= len; i += 64){
+        __m256i eq0 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+        __m256i eq1 = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i + 32)), _mm256_loadu_si256((const __m256i*)(b + i + 32)));
+        uint32_t mask0 = (uint32_t)_mm256_movemask_epi8(eq0);
+        uint32_t mask1 = (uint32_t)_mm256_movemask_epi8(eq1);
+        if((mask0 & mask1) != UINT32_MAX){
+            return mask0 != UINT32_MAX ? i + __builtin_ctz(~mask0) : i + 32 + __builtin_ctz(~mask1);
+        }
+    }
+    for(; i + 32 <= len; i += 32){
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i))));
+        if(mask != UINT32_MAX){
+            return i + __builtin_ctz(~mask);
+        }
+    }
+    return i + buffer_mismatch_scalar(a + i, b + i, len - i);
+}
+#endif
+
+size_t buffer_mismatch(const void* a, const void* b, size_t len){
+#if LIST_HAS_AVX2_KERNEL
+    if(list_has_avx2()){
+        return buffer_mismatch_avx2((const unsigned char*)a, (const unsigned char*)b, len);
+    }
+#endif
+    return buffer_mismatch_scalar((const unsigned char*)a, (const unsigned char*)b, len);
+}
+
+//比较question3和RandListSnapshot复制rand链表，以及逐字节比较和buffer_mismatch
+void benchmark_rand_list_clone(size_t len){
+    mt19937_64 rng(9);
+    vector<randListNode*> nodes(len);
+    vector<size_t> order(len);
+    for(size_t i = 0; i < len; i++){
+        order[i] = i;
+    }
+    shuffle(order.begin(), order.end(), rng);//节点按随机顺序分配，模拟长时间运行后散落在堆里的链表
+    for(size_t i = 0; i < len; i++){
+        nodes[order[i]] = new randListNode((int)i);
+    }
+    for(size_t i = 0; i < len; i++){
+        nodes[i]->value = (int)i;
+        nodes[i]->next = i + 1 < len ? nodes[i + 1] : nullptr;
+        nodes[i]->rand = rng() % 8 == 0 ? nullptr : nodes[rng() % len];
+    }
+    auto nanos = [](chrono::steady_clock::time_point start){
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count() * 1e9;
+    };
+    cout<<"len = "<<len<<" (ns/node)"<<endl;
+
+    auto start = chrono::steady_clock::now();
+    randListNode* copied = question3(nodes[0]);
+    double interleave_time = nanos(start);
+    start = chrono::steady_clock::now();
+    RandListSnapshot snapshot(nodes[0]);
+    double snapshot_time = nanos(start);
+    bool same = true;
+    randListNode* x = copied;
+    randListNode* y = snapshot.head();
+    for(size_t i = 0; i < len; i++, x = x->next, y = y->next){
+        bool rand_null = nodes[i]->rand == nullptr;
+        same = same && x->value == (int)i && y->value == (int)i && (x->rand == nullptr) == rand_null && (y->rand == nullptr) == rand_null
+                    && (rand_null || (x->rand->value == nodes[i]->rand->value && y->rand == snapshot.head() + nodes[i]->rand->value));
+    }
+    cout<<"clone: question3 "<<interleave_time / len<<", snapshot "<<snapshot_time / len<<(same ? "" : " (wrong)")<<endl;
+    while(copied != nullptr){
+        randListNode* next = copied->next;
+        delete copied;
+        copied = next;
+    }
+    for(randListNode* node : nodes){
+        delete node;
+    }
+
+    //比较两块只有最后一个字节不同的内存
+    size_t bytes = len * sizeof(randListNode);
+    vector<unsigned char> a(bytes, 7), b(bytes, 7);
+    b[bytes - 1] = 8;
+    start = chrono::steady_clock::now();
+    size_t byte_result = 0;
+    while(byte_result < bytes && a[byte_result] == b[byte_result]){
+        byte_result++;
+    }
+    double byte_time = nanos(start);
+    start = chrono::steady_clock::now();
+    size_t fast_result = buffer_mismatch(a.data(), b.data(), bytes);
+    double fast_time = nanos(start);
+    cout<<"compare "<<bytes<<" bytes (ns/byte): byte by byte "<<byte_time / bytes<<", buffer_mismatch"<<(list_has_avx2() ? " avx2 " : " ")<<fast_time / bytes
+        <<(byte_result == fast_result && fast_result == bytes - 1 ? "" : " (wrong)")<<endl;
+}
+
+int main(int argc, char* argv[]){
+    if(argc > 1 && string(argv[1]) == "bench"){
+        benchmark_list_pool(argc > 2 ? (size_t)atoll(argv[2]) : 10000000);
+        return 0;
+    }
+    if(argc > 1 && string(argv[1]) == "bench-unrolled"){
+        benchmark_unrolled_list(argc > 2 ? (size_t)atoll(argv[2]) : 10000000);
+        return 0;
+    }
+    if(argc > 1 && string(argv[1]) == "bench-clone"){
+        benchmark_rand_list_clone(argc > 2 ? (size_t)atoll(argv[2]) : 1000000);
+        return 0;
+    }
 
 //    randListNode* head = new randListNode(1);
 //    randListNode* one = new randListNode(2);
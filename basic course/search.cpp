@@ -1,9 +1,34 @@
 #include<iostream>
+#include<vector>
+#include<algorithm>
+#include<cstdint>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<chrono>
+#include<random>
+#include<type_traits>
+#include<limits>
+#include<stdexcept>
+#include<thread>
+#include<cstdio>
+#if defined(__unix__) || defined(__APPLE__)
+#define SEARCH_HAS_MMAP 1
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+#else
+#define SEARCH_HAS_MMAP 0
+#endif
 
 using namespace std;
 
 int bin_search(int arr[], int len, int target);
 int question1(int arr[]);
+void benchmark_search(size_t len, size_t query_num);//比较二分查找、Eytzinger布局和k叉查找树的查找
+void benchmark_learned_index(size_t len, size_t query_num);//比较学习索引、二分查找和Eytzinger布局
+void benchmark_extrema(size_t len);//比较逐个比较和多线程SIMD求局部最值
 
 int bin_search(int arr[], int len, int target){
 	if(len <= 1){
@@ -65,8 +90,879 @@ int question1(int arr[], int len){
 	return -1;
 }
 
+/*************************Eytzinger布局的静态查找*************************
+ * 二分查找每一次比较都依赖上一次的结果，在大数组上每次访问基本都是一次缓存未命中，而且分支很难预测
+ * 把有序数组按BFS顺序（Eytzinger布局）重新存放：下标从1开始，k的左右孩子是2k和2k+1
+ *      1）前几层的节点集中在数组开头，总是在缓存里；
+ *      2）k往下4层的16个后代是16k~16k+15，数组按64字节对齐后int正好在同一个缓存行里，可以提前预取；
+ *      3）下降时k = 2k + (tree[k] < target)，没有分支；走到叶子以后，k的二进制末尾的1是最后几次向右走，
+ *         右移掉这些1和最后一次向左走的0，就得到lower_bound所在的节点（k为0表示所有数都小于target）
+ * lower_bound_many把一批查询交错着一层一层地往下走，同时有很多个互不依赖的访存在路上，把内存延迟藏起来
+ * 只支持整数、浮点数这种可以直接拷贝的键，长度小于2^32（每个节点另外存一个32位的原下标）
+ */
+const size_t SEARCH_CACHE_LINE = 64;
+const size_t SEARCH_BATCH = 16;//lower_bound_many每次交错执行的查询个数
 
-int main(){
+template<typename T, size_t Align>
+struct AlignedAllocator{
+	typedef T value_type;
+	template<typename U>
+	struct rebind{
+		typedef AlignedAllocator<U, Align> other;
+	};
+	AlignedAllocator() {}
+	template<typename U>
+	AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+	//多申请一些空间，对齐后的地址前面保存原始地址
+	T* allocate(size_t n){
+		void* raw = ::operator new(n * sizeof(T) + Align + sizeof(void*));
+		uintptr_t aligned = ((uintptr_t)raw + sizeof(void*) + Align - 1) & ~(uintptr_t)(Align - 1);
+		((void**)aligned)[-1] = raw;
+		return (T*)aligned;
+	}
+	void deallocate(T* p, size_t){
+		::operator delete(((void**)p)[-1]);
+	}
+};
+
+template<typename T, typename U, size_t Align>
+bool operator==(const AlignedAllocator<T, Align>&, const AlignedAllocator<U, Align>&){ return true; }
+template<typename T, typename U, size_t Align>
+bool operator!=(const AlignedAllocator<T, Align>&, const AlignedAllocator<U, Align>&){ return false; }
+
+inline void search_prefetch(const void* address){
+#if defined(__GNUC__)
+	__builtin_prefetch(address);
+#else
+	(void)address;
+#endif
+}
+
+//右移掉k末尾连续的1以及紧接着的一个0
+inline size_t eytzinger_restore(size_t k){
+#if defined(__GNUC__)
+	return k >> __builtin_ffsll(~(unsigned long long)k);
+#else
+	while(k & 1){
+		k >>= 1;
+	}
+	return k >> 1;
+#endif
+}
+
+template<typename T>
+class EytzingerIndex{
+public:
+	//sorted必须是升序的
+	EytzingerIndex(const T* sorted, size_t len) : n(len), tree(len + 1), rank(len + 1) {
+		static_assert(is_arithmetic<T>::value, "EytzingerIndex only supports integer and floating point keys");
+		if(len >= (size_t)UINT32_MAX){
+			throw length_error("EytzingerIndex: too many keys");
+		}
+		build(sorted, 0, 1);
+		height = 0;
+		while(((size_t)1 << height) <= n){
+			height++;
+		}
+	}
+
+	size_t size() const {
+		return n;
+	}
+
+	//返回第一个不小于target的数在原有序数组中的下标，不存在时返回size()
+	size_t lower_bound(const T& target) const {
+		size_t k = find_slot(target);
+		return k == 0 ? n : rank[k];
+	}
+
+	//批量查找，result[i]为queries[i]的lower_bound
+	void lower_bound_many(const T* queries, size_t count, size_t* result) const {
+		const T* base = tree.data();
+		size_t k[SEARCH_BATCH];
+		for(size_t start = 0; start < count; start += SEARCH_BATCH){
+			size_t batch = min(SEARCH_BATCH, count - start);
+			const T* q = queries + start;
+			for(size_t j = 0; j < batch; j++){
+				k[j] = 1;
+			}
+			//前height-1层是满的，所有查询一起往下走
+			for(int level = 1; level < height; level++){
+				for(size_t j = 0; j < batch; j++){
+					k[j] = 2 * k[j] + (base[k[j]] < q[j]);
+					search_prefetch(base + k[j]);
+				}
+			}
+			//最后一层可能不满
+			for(size_t j = 0; j < batch; j++){
+				if(k[j] <= n){
+					k[j] = 2 * k[j] + (base[k[j]] < q[j]);
+				}
+				k[j] = eytzinger_restore(k[j]);
+				search_prefetch(rank.data() + k[j]);
+			}
+			for(size_t j = 0; j < batch; j++){
+				result[start + j] = k[j] == 0 ? n : rank[k[j]];
+			}
+		}
+	}
+
+	//是否存在target
+	bool contains(const T& target) const {
+		size_t k = find_slot(target);
+		return k != 0 && !(target < tree[k]);
+	}
+
+private:
+	size_t n;
+	int height;//树的层数
+	vector<T, AlignedAllocator<T, SEARCH_CACHE_LINE>> tree;//tree[0]不用
+	vector<uint32_t> rank;//rank[k]为节点k在原有序数组中的下标
+
+	//中序遍历的顺序就是有序数组的顺序
+	size_t build(const T* sorted, size_t i, size_t k){
+		if(k <= n){
+			i = build(sorted, i, 2 * k);
+			tree[k] = sorted[i];
+			rank[k] = (uint32_t)i;
+			i++;
+			i = build(sorted, i, 2 * k + 1);
+		}
+		return i;
+	}
+
+	//第一个不小于target的节点，0表示不存在
+	size_t find_slot(const T& target) const {
+		const T* base = tree.data();
+		const size_t prefetch_step = max<size_t>(SEARCH_CACHE_LINE / sizeof(T), 1);
+		size_t k = 1;
+		while(k <= n){
+			search_prefetch(base + k * prefetch_step);//4层之后的后代所在的缓存行（int为16个）
+			k = 2 * k + (base[k] < target);
+		}
+		return eytzinger_restore(k);
+	}
+};
+
+/*************************SIMD k叉查找树（FAST）*************************
+ * Eytzinger布局每个缓存行只用到一个键，k叉查找树把一个缓存行（64字节）装满键作为一个节点：
+ *      int32/float每个节点16个键、17个孩子，int64每个节点8个键、9个孩子，查找一次大约log_17(n)次缓存未命中
+ *      节点k的第i个孩子是k*(B+1)+i+1，和Eytzinger一样按中序遍历的顺序把有序数组填进去，最后不满的位置填最大值
+ * 在节点内查找时，用AVX2一次比较8个（int64为4个）键，movemask取出比较结果，
+ * 节点内的键有序，所以小于target的键的个数（popcount）就是要往下走的孩子编号
+ * 走过的每个节点里第一个不小于target的位置都是候选，越往下的候选越靠前，最后一个候选就是lower_bound
+ * 底层的有序数组变化以后用rebuild整体重建
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEARCH_HAS_AVX2_KERNEL 1
+#include<immintrin.h>
+#else
+#define SEARCH_HAS_AVX2_KERNEL 0
+#endif
+
+inline bool search_has_avx2(){
+#if SEARCH_HAS_AVX2_KERNEL
+	static const bool supported = __builtin_cpu_supports("avx2");
+	return supported;
+#else
+	return false;
+#endif
+}
+
+//节点中小于target的键的个数
+template<typename T>
+int node_count_less(const T* node, int key_num, T target, bool){
+	int count = 0;
+	for(int i = 0; i < key_num; i++){
+		count += node[i] < target;
+	}
+	return count;
+}
+
+#if SEARCH_HAS_AVX2_KERNEL
+__attribute__((target("avx2"))) inline int node_count_less_avx2(const int32_t* node, int32_t target){
+	__m256i x = _mm256_set1_epi32(target);
+	__m256i low = _mm256_cmpgt_epi32(x, _mm256_load_si256((const __m256i*)node));
+	__m256i high = _mm256_cmpgt_epi32(x, _mm256_load_si256((const __m256i*)(node + 8)));
+	int mask = _mm256_movemask_ps(_mm256_castsi256_ps(low)) | (_mm256_movemask_ps(_mm256_castsi256_ps(high)) << 8);
+	return __builtin_popcount(mask);
+}
+
+__attribute__((target("avx2"))) inline int node_count_less_avx2(const int64_t* node, int64_t target){
+	__m256i x = _mm256_set1_epi64x(target);
+	__m256i low = _mm256_cmpgt_epi64(x, _mm256_load_si256((const __m256i*)node));
+	__m256i high = _mm256_cmpgt_epi64(x, _mm256_load_si256((const __m256i*)(node + 4)));
+	int mask = _mm256_movemask_pd(_mm256_castsi256_pd(low)) | (_mm256_movemask_pd(_mm256_castsi256_pd(high)) << 4);
+	return __builtin_popcount(mask);
+}
+
+__attribute__((target("avx2"))) inline int node_count_less_avx2(const float* node, float target){
+	__m256 x = _mm256_set1_ps(target);
+	__m256 low = _mm256_cmp_ps(_mm256_load_ps(node), x, _CMP_LT_OQ);
+	__m256 high = _mm256_cmp_ps(_mm256_load_ps(node + 8), x, _CMP_LT_OQ);
+	int mask = _mm256_movemask_ps(low) | (_mm256_movemask_ps(high) << 8);
+	return __builtin_popcount(mask);
+}
+
+//int32/int64/float在支持AVX2时整节点比较，其余类型逐个比较
+inline int node_count_less(const int32_t* node, int key_num, int32_t target, bool avx2){
+	return avx2 ? node_count_less_avx2(node, target) : node_count_less<int32_t>(node, key_num, target, false);
+}
+
+inline int node_count_less(const int64_t* node, int key_num, int64_t target, bool avx2){
+	return avx2 ? node_count_less_avx2(node, target) : node_count_less<int64_t>(node, key_num, target, false);
+}
+
+inline int node_count_less(const float* node, int key_num, float target, bool avx2){
+	return avx2 ? node_count_less_avx2(node, target) : node_count_less<float>(node, key_num, target, false);
+}
+#endif
+
+template<typename T>
+class KaryIndex{
+public:
+	static const int KEYS = (int)(SEARCH_CACHE_LINE / sizeof(T));//每个节点的键数
+
+	KaryIndex(const T* sorted, size_t len) : n(0), block_num(0), avx2(search_has_avx2()) {
+		static_assert(is_arithmetic<T>::value, "KaryIndex only supports integer and floating point keys");
+		rebuild(sorted, len);
+	}
+
+	//底层有序数组变化后整体重建
+	void rebuild(const T* sorted, size_t len){
+		if(len >= (size_t)UINT32_MAX){
+			throw length_error("KaryIndex: too many keys");
+		}
+		n = len;
+		block_num = (len + KEYS - 1) / KEYS;
+		tree.assign(block_num * KEYS, padding());
+		rank.assign(block_num * KEYS, (uint32_t)len);
+		size_t filled = 0;
+		build(sorted, filled, 0);
+	}
+
+	size_t size() const {
+		return n;
+	}
+
+	//返回第一个不小于target的数在原有序数组中的下标，不存在时返回size()
+	size_t lower_bound(const T& target) const {
+		size_t candidate = find_slot(target);
+		return candidate == tree.size() ? n : rank[candidate];
+	}
+
+	bool contains(const T& target) const {
+		size_t candidate = find_slot(target);
+		return candidate < tree.size() && rank[candidate] < n && !(target < tree[candidate]);
+	}
+
+private:
+	size_t n;
+	size_t block_num;
+	bool avx2;
+	vector<T, AlignedAllocator<T, SEARCH_CACHE_LINE>> tree;//第k个节点是tree[k*KEYS, (k+1)*KEYS)
+	vector<uint32_t> rank;//每个位置在原有序数组中的下标，填充的位置为n
+
+	//填充值必须不小于任何键：浮点数用+inf（max()比+inf小），整数用max()
+	static T padding(){
+		return numeric_limits<T>::has_infinity ? numeric_limits<T>::infinity() : numeric_limits<T>::max();
+	}
+
+	static size_t child(size_t k, int i){
+		return k * (KEYS + 1) + i + 1;
+	}
+
+	//最后一个候选位置，没有候选时返回tree.size()
+	size_t find_slot(const T& target) const {
+		const T* base = tree.data();
+		size_t candidate = tree.size();
+		size_t k = 0;
+		while(k < block_num){
+			int i = node_count_less(base + k * KEYS, KEYS, target, avx2);
+			if(i < KEYS){
+				candidate = k * KEYS + i;
+			}
+			k = child(k, i);
+		}
+		return candidate;
+	}
+
+	//按中序遍历的顺序填入有序数组
+	void build(const T* sorted, size_t& filled, size_t k){
+		if(k >= block_num){
+			return;
+		}
+		for(int i = 0; i < KEYS; i++){
+			build(sorted, filled, child(k, i));
+			if(filled < n){
+				tree[k * KEYS + i] = sorted[filled];
+				rank[k * KEYS + i] = (uint32_t)filled;
+			}
+			filled++;
+		}
+		build(sorted, filled, child(k, KEYS));
+	}
+};
+
+//测试std::lower_bound、Eytzinger单个查询和批量查询、k叉查找树的速度
+void benchmark_search(size_t len, size_t query_num){
+	mt19937_64 rng(42);
+	vector<int> sorted(len);
+	for(auto& x : sorted){
+		x = (int)(rng() >> 33);
+	}
+	sort(sorted.begin(), sorted.end());
+	vector<int> queries(query_num);
+	for(auto& x : queries){
+		x = (int)(rng() >> 33);
+	}
+	EytzingerIndex<int> index(sorted.data(), len);
+	KaryIndex<int> kary(sorted.data(), len);
+	vector<size_t> expect(query_num), result(query_num);
+
+	auto start = chrono::steady_clock::now();
+	for(size_t i = 0; i < query_num; i++){
+		expect[i] = std::lower_bound(sorted.begin(), sorted.end(), queries[i]) - sorted.begin();
+	}
+	double binary = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	start = chrono::steady_clock::now();
+	for(size_t i = 0; i < query_num; i++){
+		result[i] = index.lower_bound(queries[i]);
+	}
+	double single = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	bool single_ok = result == expect;
+
+	start = chrono::steady_clock::now();
+	index.lower_bound_many(queries.data(), query_num, result.data());
+	double batched = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	bool batched_ok = result == expect;
+
+	start = chrono::steady_clock::now();
+	for(size_t i = 0; i < query_num; i++){
+		result[i] = kary.lower_bound(queries[i]);
+	}
+	double kary_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	bool kary_ok = result == expect;
+
+	cout<<"len = "<<len<<", queries = "<<query_num<<endl;
+	cout<<"std::lower_bound: "<<binary * 1e9 / query_num<<" ns/query"<<endl;
+	cout<<"eytzinger: "<<single * 1e9 / query_num<<" ns/query"<<(single_ok ? "" : " (wrong)")<<endl;
+	cout<<"eytzinger batched: "<<batched * 1e9 / query_num<<" ns/query"<<(batched_ok ? "" : " (wrong)")<<endl;
+	cout<<"k-ary tree"<<(search_has_avx2() ? " (avx2)" : "")<<": "<<kary_time * 1e9 / query_num<<" ns/query"<<(kary_ok ? "" : " (wrong)")<<endl;
+}
+
+/*************************分段线性的学习索引（PGM）*************************
+ * 键的分布比较均匀或者分段近似线性时，二分查找仍然要走log2(n)步，可以先用一个线性函数预测位置，再在附近查找
+ * 用收缩锥（shrinking cone）把有序数组贪心地切成若干段，每一段用 位置 ≈ start + slope * (key - first_key) 拟合：
+ *      每加入一个新的键，它允许的斜率范围是[(y - eps - start) / dx, (y + eps - start) / dx]，
+ *      和已有范围求交集，交集为空就开始新的一段，所以段内每个键的预测位置与真实位置之差不超过eps
+ *      重复的键只取第一次出现的位置
+ * 段数多的时候，把各段的first_key当作一个新的有序数组再拟合一层，直到只剩一段（和PGM-index一样递归）
+ * 查询时从最上层往下，每一层都只在预测位置附近2*eps+2个数里查找；
+ * 查询的键落在两段之间的空隙里时预测可能不准，所以查找区间的边界要检查一下，不对再在这一段剩下的范围里二分
+ * 索引不拷贝原数组，原数组在索引使用期间不能改变
+ */
+const size_t PGM_DEFAULT_EPSILON = 32;//最底层的误差
+const size_t PGM_INTERNAL_EPSILON = 4;//上层（查找段）的误差
+
+//在a[lo, hi)中查找lower_bound（upper为true时查找upper_bound），已知答案在[lo, hi]中，先在预测位置附近找
+template<typename T>
+size_t window_search(const T* a, size_t lo, size_t hi, double predict, size_t eps, const T& target, bool upper){
+	auto before = [&target, upper](const T& value){ return upper ? !(target < value) : value < target; };
+	size_t position = !(predict > (double)lo) ? lo : (predict >= (double)hi ? hi : (size_t)predict);//NaN也落到lo
+	size_t window_lo = position > lo + eps ? position - eps : lo;
+	size_t window_hi = min(position + eps + 2, hi);
+	for(size_t i = window_lo; i < window_hi; i += max<size_t>(SEARCH_CACHE_LINE / sizeof(T), 1)){//整个窗口一起预取，不用等二分的每一步
+		search_prefetch(a + i);
+	}
+	size_t result = partition_point(a + window_lo, a + window_hi, before) - a;
+	if(result == window_lo && window_lo > lo && !before(a[window_lo - 1])){
+		result = partition_point(a + lo, a + window_lo, before) - a;
+	}
+	else if(result == window_hi && window_hi < hi && before(a[window_hi])){
+		result = partition_point(a + window_hi, a + hi, before) - a;
+	}
+	return result;
+}
+
+template<typename T>
+class PgmIndex{
+public:
+	PgmIndex(const T* sorted, size_t len, size_t epsilon = PGM_DEFAULT_EPSILON) : data(sorted), n(len), eps(epsilon) {
+		static_assert(is_arithmetic<T>::value, "PgmIndex only supports integer and floating point keys");
+		levels.push_back(fit(sorted, len, eps));
+		while(levels.back().keys.size() > 1){
+			const vector<T>& keys = levels.back().keys;
+			levels.push_back(fit(keys.data(), keys.size(), PGM_INTERNAL_EPSILON));
+		}
+	}
+
+	size_t size() const {
+		return n;
+	}
+
+	//最底层的段数
+	size_t segment_count() const {
+		return levels[0].keys.size();
+	}
+
+	//返回第一个不小于target的数的下标，不存在时返回size()
+	size_t lower_bound(const T& target) const {
+		if(n == 0){
+			return 0;
+		}
+		size_t s = 0;
+		for(size_t l = levels.size() - 1; l >= 1; l--){//在下一层的段中找最后一个first_key不大于target的段
+			const Level& down = levels[l - 1];
+			size_t j = window_search(down.keys.data(), levels[l].start[s], segment_end(l, s), predict(levels[l], s, target),
+					PGM_INTERNAL_EPSILON, target, true);
+			s = j == 0 ? 0 : j - 1;
+		}
+		return window_search(data, levels[0].start[s], segment_end(0, s), predict(levels[0], s, target), eps, target, false);
+	}
+
+private:
+	struct Level{
+		vector<T> keys;//每一段的第一个键
+		vector<size_t> start;//每一段第一个键在下一层中的位置
+		vector<double> slope;
+	};
+	const T* data;
+	size_t n;
+	size_t eps;
+	vector<Level> levels;//levels[0]拟合原数组，levels[l]拟合levels[l-1].keys
+
+	//第l层第s段覆盖的范围的结束位置
+	size_t segment_end(size_t l, size_t s) const {
+		if(s + 1 < levels[l].start.size()){
+			return levels[l].start[s + 1];
+		}
+		return l == 0 ? n : levels[l - 1].keys.size();
+	}
+
+	//斜率为0的段（只有一个不同的键）不能乘：浮点键查±inf时0 * inf是NaN
+	static double predict(const Level& level, size_t s, const T& target){
+		if(level.slope[s] == 0){
+			return (double)level.start[s];
+		}
+		return (double)level.start[s] + level.slope[s] * ((double)target - (double)level.keys[s]);
+	}
+
+	//收缩锥贪心分段
+	static Level fit(const T* keys, size_t len, size_t epsilon){
+		Level level;
+		size_t i = 0;
+		while(i < len){
+			double x0 = (double)keys[i];
+			double lo = 0;
+			double hi = numeric_limits<double>::infinity();
+			size_t j = i + 1;
+			for(; j < len; j++){
+				if(keys[j] == keys[j - 1]){
+					continue;
+				}
+				double dx = (double)keys[j] - x0;
+				if(dx <= 0){//64位整数转成double以后可能相等
+					break;
+				}
+				double new_lo = ((double)j - (double)epsilon - (double)i) / dx;
+				double new_hi = ((double)j + (double)epsilon - (double)i) / dx;
+				if(max(lo, new_lo) > min(hi, new_hi)){
+					break;
+				}
+				lo = max(lo, new_lo);
+				hi = min(hi, new_hi);
+			}
+			level.keys.push_back(keys[i]);
+			level.start.push_back(i);
+			level.slope.push_back(hi == numeric_limits<double>::infinity() ? lo : (lo + hi) / 2);
+			i = j;
+		}
+		return level;
+	}
+};
+
+//学习索引在不同键分布上和二分查找、Eytzinger布局的比较
+vector<int64_t> generate_search_keys(const string& distribution, size_t len, mt19937_64& rng){
+	vector<int64_t> keys(len);
+	if(distribution == "uniform"){
+		for(auto& x : keys){
+			x = (int64_t)(rng() >> 16);
+		}
+	}
+	else if(distribution == "lognormal"){
+		lognormal_distribution<double> lognormal(0, 2);
+		for(auto& x : keys){
+			x = (int64_t)(lognormal(rng) * 1e9);
+		}
+	}
+	else{//ids：自增ID，偶尔有删除留下的空洞，偶尔整段跳号（换号段、分库）
+		int64_t id = 1000000;
+		for(auto& x : keys){
+			uint64_t r = rng() % 1000;
+			id += r < 900 ? 1 : (r < 999 ? (int64_t)(rng() % 100) + 2 : (int64_t)(rng() % 10000000));
+			x = id;
+		}
+	}
+	sort(keys.begin(), keys.end());
+	return keys;
+}
+
+void benchmark_learned_index(size_t len, size_t query_num){
+	const char* distributions[] = {"uniform", "lognormal", "ids"};
+	for(const char* distribution : distributions){
+		mt19937_64 rng(7);
+		vector<int64_t> keys = generate_search_keys(distribution, len, rng);
+		vector<int64_t> queries(query_num);
+		for(size_t i = 0; i < query_num; i++){//一半查存在的键，一半查随机的键
+			queries[i] = (i & 1) ? keys[rng() % len] : keys[0] + (int64_t)(rng() % (uint64_t)(keys[len - 1] - keys[0] + 1));
+		}
+		EytzingerIndex<int64_t> eytzinger(keys.data(), len);
+		PgmIndex<int64_t> pgm(keys.data(), len);
+		vector<size_t> expect(query_num), result(query_num);
+
+		auto start = chrono::steady_clock::now();
+		for(size_t i = 0; i < query_num; i++){
+			expect[i] = std::lower_bound(keys.begin(), keys.end(), queries[i]) - keys.begin();
+		}
+		double binary = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		start = chrono::steady_clock::now();
+		for(size_t i = 0; i < query_num; i++){
+			result[i] = eytzinger.lower_bound(queries[i]);
+		}
+		double eytzinger_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		bool eytzinger_ok = result == expect;
+
+		start = chrono::steady_clock::now();
+		for(size_t i = 0; i < query_num; i++){
+			result[i] = pgm.lower_bound(queries[i]);
+		}
+		double pgm_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		bool pgm_ok = result == expect;
+
+		cout<<distribution<<" (len = "<<len<<", queries = "<<query_num<<", segments = "<<pgm.segment_count()<<")"<<endl;
+		cout<<"  std::lower_bound: "<<binary * 1e9 / query_num<<" ns/query"<<endl;
+		cout<<"  eytzinger: "<<eytzinger_time * 1e9 / query_num<<" ns/query"<<(eytzinger_ok ? "" : " (wrong)")<<endl;
+		cout<<"  pgm: "<<pgm_time * 1e9 / query_num<<" ns/query"<<(pgm_ok ? "" : " (wrong)")<<endl;
+	}
+
+	//浮点键的边界情况：只有一个键、末尾单独一个键、键里有±inf，查询±inf
+	const float inf = numeric_limits<float>::infinity();
+	vector<vector<float>> edge_keys = {{5.0f}, {-inf}, {inf}, {1.0f, 2.0f, 3.0f, 1e30f}, {-inf, 0.0f, 0.0f, 1.0f, inf}};
+	vector<float> line(1000);
+	for(size_t i = 0; i < line.size(); i++){
+		line[i] = (float)i;
+	}
+	line.push_back(1e9f);
+	edge_keys.push_back(line);
+	bool edge_ok = true;
+	for(const auto& keys : edge_keys){
+		PgmIndex<float> pgm(keys.data(), keys.size(), 4);
+		vector<float> queries = {-inf, inf, 0.5f, -1e38f, 1e38f};
+		queries.insert(queries.end(), keys.begin(), keys.end());
+		for(float q : queries){
+			edge_ok = edge_ok && pgm.lower_bound(q) == (size_t)(std::lower_bound(keys.begin(), keys.end(), q) - keys.begin());
+		}
+	}
+	cout<<"pgm float edge cases: "<<(edge_ok ? "ok" : "wrong")<<endl;
+}
+
+/*************************批量求局部最小值、最大值*************************
+ * question1用二分只能找到一个局部最小值，这里把所有的局部最小值和局部最大值（波谷和波峰）都找出来：
+ *      i是局部最小值：arr[i] < arr[i-1]且arr[i] < arr[i+1]（两端只和一个邻居比较），局部最大值反过来，相等的平台不算
+ *      1）每个位置只需要和左右邻居比较，用AVX2一次比较8个int32/float：分别从i-1、i、i+1开始各读8个数，
+ *         两次比较相与得到8位的掩码，再按掩码查表把下标紧凑地写到输出里（stream compaction），没有分支
+ *      2）数组切成和线程数一样多的段，每段读邻居时直接读整个数组里的数，所以段的边界不会漏掉也不会重复；
+ *         每段再按EXTREMA_BLOCK分块，块内先写32位的偏移，再转换成全局下标追加到这一段的结果里，
+ *         结果按段号拼接，下标自然有序
+ *      3）数据在文件里时可以用mmap直接映射进来扫描，不用先读到内存里
+ */
+const size_t EXTREMA_BLOCK = 1 << 16;//块内的偏移用32位存放
+
+#if SEARCH_HAS_AVX2_KERNEL
+//8个通道的下标按掩码紧凑排列的置换表
+struct CompressTable{
+	alignas(32) int index[256][8];
+	CompressTable(){
+		for(int mask = 0; mask < 256; mask++){
+			int pos = 0;
+			for(int lane = 0; lane < 8; lane++){
+				if(mask & (1 << lane)){
+					index[mask][pos++] = lane;
+				}
+			}
+			while(pos < 8){
+				index[mask][pos++] = 0;
+			}
+		}
+	}
+};
+
+inline const CompressTable& compress_table(){
+	static const CompressTable table;
+	return table;
+}
+
+//p[0..8)中局部最小值、局部最大值的掩码
+__attribute__((target("avx2"))) inline void extrema_masks(const int32_t* p, int& min_mask, int& max_mask){
+	__m256i v = _mm256_loadu_si256((const __m256i*)p);
+	__m256i left = _mm256_loadu_si256((const __m256i*)(p - 1));
+	__m256i right = _mm256_loadu_si256((const __m256i*)(p + 1));
+	min_mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpgt_epi32(left, v), _mm256_cmpgt_epi32(right, v))));
+	max_mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpgt_epi32(v, left), _mm256_cmpgt_epi32(v, right))));
+}
+
+__attribute__((target("avx2"))) inline void extrema_masks(const float* p, int& min_mask, int& max_mask){
+	__m256 v = _mm256_loadu_ps(p);
+	__m256 left = _mm256_loadu_ps(p - 1);
+	__m256 right = _mm256_loadu_ps(p + 1);
+	min_mask = _mm256_movemask_ps(_mm256_and_ps(_mm256_cmp_ps(v, left, _CMP_LT_OQ), _mm256_cmp_ps(v, right, _CMP_LT_OQ)));
+	max_mask = _mm256_movemask_ps(_mm256_and_ps(_mm256_cmp_ps(v, left, _CMP_GT_OQ), _mm256_cmp_ps(v, right, _CMP_GT_OQ)));
+}
+#endif
+
+//扫描内部的位置[begin, end)（要求begin >= 1、end + 1 <= len），把相对begin的偏移写进minima、maxima
+//不用分支：每个位置都先写进去，是局部最值时个数才加一，所以输出数组要比结果多留一个位置
+template<typename T>
+void extrema_scan(const T* data, size_t begin, size_t end, uint32_t* minima, size_t& min_num, uint32_t* maxima, size_t& max_num, bool){
+	for(size_t i = begin; i < end; i++){
+		T value = data[i];
+		T left = data[i - 1];
+		T right = data[i + 1];
+		minima[min_num] = (uint32_t)(i - begin);
+		min_num += (value < left) & (value < right);
+		maxima[max_num] = (uint32_t)(i - begin);
+		max_num += (left < value) & (right < value);
+	}
+}
+
+#if SEARCH_HAS_AVX2_KERNEL
+//输出数组要比结果多留8个位置
+template<typename T>
+__attribute__((target("avx2"))) void extrema_scan_avx2(const T* data, size_t begin, size_t end, uint32_t* minima, size_t& min_num, uint32_t* maxima, size_t& max_num){
+	const CompressTable& table = compress_table();
+	__m256i offset = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i step = _mm256_set1_epi32(8);
+	size_t i = begin;
+	for(; i + 8 <= end; i += 8){
+		int min_mask, max_mask;
+		extrema_masks(data + i, min_mask, max_mask);
+		__m256i packed = _mm256_permutevar8x32_epi32(offset, _mm256_load_si256((const __m256i*)table.index[min_mask]));
+		_mm256_storeu_si256((__m256i*)(minima + min_num), packed);
+		min_num += __builtin_popcount(min_mask);
+		packed = _mm256_permutevar8x32_epi32(offset, _mm256_load_si256((const __m256i*)table.index[max_mask]));
+		_mm256_storeu_si256((__m256i*)(maxima + max_num), packed);
+		max_num += __builtin_popcount(max_mask);
+		offset = _mm256_add_epi32(offset, step);
+	}
+	//剩下不足8个的逐个比较，偏移是相对i的，要再加上i-begin
+	size_t tail_min = min_num;
+	size_t tail_max = max_num;
+	extrema_scan(data, i, end, minima, min_num, maxima, max_num, false);
+	for(size_t k = tail_min; k < min_num; k++){
+		minima[k] += (uint32_t)(i - begin);
+	}
+	for(size_t k = tail_max; k < max_num; k++){
+		maxima[k] += (uint32_t)(i - begin);
+	}
+}
+
+//int32和float在支持AVX2时用SIMD扫描
+inline void extrema_scan(const int32_t* data, size_t begin, size_t end, uint32_t* minima, size_t& min_num, uint32_t* maxima, size_t& max_num, bool avx2){
+	if(avx2){
+		extrema_scan_avx2(data, begin, end, minima, min_num, maxima, max_num);
+	}
+	else{
+		extrema_scan<int32_t>(data, begin, end, minima, min_num, maxima, max_num, false);
+	}
+}
+
+inline void extrema_scan(const float* data, size_t begin, size_t end, uint32_t* minima, size_t& min_num, uint32_t* maxima, size_t& max_num, bool avx2){
+	if(avx2){
+		extrema_scan_avx2(data, begin, end, minima, min_num, maxima, max_num);
+	}
+	else{
+		extrema_scan<float>(data, begin, end, minima, min_num, maxima, max_num, false);
+	}
+}
+#endif
+
+//求data[lo, hi)中的局部最小值和局部最大值，下标是全局的
+template<typename T>
+void find_extrema_range(const T* data, size_t len, size_t lo, size_t hi, vector<size_t>& minima, vector<size_t>& maxima, bool avx2){
+	if(lo == 0){//左端点只有右邻居，只有一个数时既是局部最小值也是局部最大值
+		if(len == 1 || data[0] < data[1]){
+			minima.push_back(0);
+		}
+		if(len == 1 || data[1] < data[0]){
+			maxima.push_back(0);
+		}
+	}
+	vector<uint32_t> min_buffer(EXTREMA_BLOCK / 2 + 16);//严格的局部最小值不会相邻
+	vector<uint32_t> max_buffer(EXTREMA_BLOCK / 2 + 16);
+	size_t interior_end = min(hi, len - 1);
+	for(size_t begin = max<size_t>(lo, 1); begin < interior_end; begin += EXTREMA_BLOCK){
+		size_t end = min(begin + EXTREMA_BLOCK, interior_end);
+		size_t min_num = 0;
+		size_t max_num = 0;
+		extrema_scan(data, begin, end, min_buffer.data(), min_num, max_buffer.data(), max_num, avx2);
+		size_t old_min = minima.size();
+		size_t old_max = maxima.size();
+		minima.resize(old_min + min_num);
+		maxima.resize(old_max + max_num);
+		for(size_t k = 0; k < min_num; k++){
+			minima[old_min + k] = begin + min_buffer[k];
+		}
+		for(size_t k = 0; k < max_num; k++){
+			maxima[old_max + k] = begin + max_buffer[k];
+		}
+	}
+	if(hi == len && len > 1){//右端点只有左邻居
+		if(data[len - 1] < data[len - 2]){
+			minima.push_back(len - 1);
+		}
+		if(data[len - 2] < data[len - 1]){
+			maxima.push_back(len - 1);
+		}
+	}
+}
+
+//多线程求所有局部最小值和局部最大值的下标（升序），thread_num为0时使用全部核
+template<typename T>
+void find_extrema(const T* data, size_t len, vector<size_t>& minima, vector<size_t>& maxima, unsigned thread_num = 0){
+	minima.clear();
+	maxima.clear();
+	if(len == 0){
+		return;
+	}
+	bool avx2 = search_has_avx2();
+	if(thread_num == 0){
+		thread_num = max(thread::hardware_concurrency(), 1u);
+	}
+	size_t chunk_num = min<size_t>(thread_num, (len + EXTREMA_BLOCK - 1) / EXTREMA_BLOCK);
+	if(chunk_num <= 1){
+		find_extrema_range(data, len, 0, len, minima, maxima, avx2);
+		return;
+	}
+	size_t chunk_len = (len + chunk_num - 1) / chunk_num;
+	vector<vector<size_t>> chunk_minima(chunk_num), chunk_maxima(chunk_num);
+	vector<thread> workers;
+	for(size_t chunk = 0; chunk < chunk_num; chunk++){
+		size_t lo = chunk * chunk_len;
+		size_t hi = min(lo + chunk_len, len);
+		workers.emplace_back([=, &chunk_minima, &chunk_maxima]{
+			find_extrema_range(data, len, lo, hi, chunk_minima[chunk], chunk_maxima[chunk], avx2);
+		});
+	}
+	for(thread& worker : workers){
+		worker.join();
+	}
+	for(size_t chunk = 0; chunk < chunk_num; chunk++){
+		minima.insert(minima.end(), chunk_minima[chunk].begin(), chunk_minima[chunk].end());
+		maxima.insert(maxima.end(), chunk_maxima[chunk].begin(), chunk_maxima[chunk].end());
+	}
+}
+
+//对二进制文件（连续存放的T）求局部最值，支持mmap时直接映射文件，打不开文件返回false
+template<typename T>
+bool find_extrema_file(const char* path, vector<size_t>& minima, vector<size_t>& maxima, unsigned thread_num = 0){
+#if SEARCH_HAS_MMAP
+	int fd = open(path, O_RDONLY);
+	if(fd < 0){
+		return false;
+	}
+	struct stat info;
+	if(fstat(fd, &info) != 0){
+		close(fd);
+		return false;
+	}
+	size_t len = (size_t)info.st_size / sizeof(T);
+	if(len == 0){
+		close(fd);
+		minima.clear();
+		maxima.clear();
+		return true;
+	}
+	void* mapped = mmap(nullptr, len * sizeof(T), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(mapped == MAP_FAILED){
+		return false;
+	}
+	madvise(mapped, len * sizeof(T), MADV_SEQUENTIAL);
+	find_extrema((const T*)mapped, len, minima, maxima, thread_num);
+	munmap(mapped, len * sizeof(T));
+	return true;
+#else
+	FILE* file = fopen(path, "rb");
+	if(file == nullptr){
+		return false;
+	}
+	vector<T> data;
+	T buffer[4096];
+	size_t count;
+	while((count = fread(buffer, sizeof(T), 4096, file)) > 0){
+		data.insert(data.end(), buffer, buffer + count);
+	}
+	fclose(file);
+	find_extrema(data.data(), data.size(), minima, maxima, thread_num);
+	return true;
+#endif
+}
+
+//随机游走的序列上比较单线程逐个比较和多线程SIMD扫描
+void benchmark_extrema(size_t len){
+	mt19937_64 rng(11);
+	vector<int32_t> series(len);
+	int32_t value = 0;
+	for(auto& x : series){
+		value += (int32_t)(rng() % 7) - 3;
+		x = value;
+	}
+	//每种方法先跑一遍不计时，让输出数组的内存先分配好，计时只算扫描
+	vector<size_t> expect_min, expect_max, minima, maxima;
+	find_extrema_range(series.data(), len, 0, len, expect_min, expect_max, false);
+	expect_min.clear();
+	expect_max.clear();
+	auto start = chrono::steady_clock::now();
+	find_extrema_range(series.data(), len, 0, len, expect_min, expect_max, false);
+	double scalar = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	find_extrema(series.data(), len, minima, maxima);
+	start = chrono::steady_clock::now();
+	find_extrema(series.data(), len, minima, maxima);
+	double parallel = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	bool ok = minima == expect_min && maxima == expect_max;
+	cout<<"len = "<<len<<", minima = "<<minima.size()<<", maxima = "<<maxima.size()<<endl;
+	cout<<"scalar: "<<scalar * 1e9 / len<<" ns/element"<<endl;
+	cout<<"parallel"<<(search_has_avx2() ? " avx2" : "")<<": "<<parallel * 1e9 / len<<" ns/element"<<(ok ? "" : " (wrong)")<<endl;
+}
+
+int main(int argc, char* argv[]){
+	if(argc > 1 && string(argv[1]) == "bench"){
+		benchmark_search(argc > 2 ? (size_t)atoll(argv[2]) : 10000000, argc > 3 ? (size_t)atoll(argv[3]) : 1000000);
+		return 0;
+	}
+	if(argc > 1 && string(argv[1]) == "bench-learned"){
+		benchmark_learned_index(argc > 2 ? (size_t)atoll(argv[2]) : 10000000, argc > 3 ? (size_t)atoll(argv[3]) : 1000000);
+		return 0;
+	}
+	if(argc > 1 && string(argv[1]) == "extrema-bench"){
+		benchmark_extrema(argc > 2 ? (size_t)atoll(argv[2]) : 100000000);
+		return 0;
+	}
+	if(argc > 2 && string(argv[1]) == "extrema"){//search extrema <file> [int|float]
+		vector<size_t> minima, maxima;
+		bool ok = argc > 3 && string(argv[3]) == "float" ? find_extrema_file<float>(argv[2], minima, maxima)
+				: find_extrema_file<int32_t>(argv[2], minima, maxima);
+		if(!ok){
+			cout<<"cannot read "<<argv[2]<<endl;
+			return 1;
+		}
+		cout<<"minima = "<<minima.size()<<", maxima = "<<maxima.size()<<endl;
+		return 0;
+	}
 	int arr[] = {3,3,3,4,5,6,8,7,9};
 	int index = question1(arr, 9);
 	cout<<index<<endl;
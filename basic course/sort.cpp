@@ -3,12 +3,45 @@
 #include<ctime>
 #include<algorithm>
 #include<cmath>
+#include<vector>
+#include<iterator>
+#include<functional>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<deque>
+#include<atomic>
+#include<cstring>
+#include<cstdint>
+#include<type_traits>
+#include<limits>
+#include<string>
+#include<cstdio>
+#include<future>
+#include<memory>
+#include<chrono>
+#include<random>
+#include<new>
+#include<stdexcept>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SORT_HAS_AVX2_KERNEL 1
+#include<immintrin.h>
+#else
+#define SORT_HAS_AVX2_KERNEL 0
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#define SORT_HAS_GETPID 1
+#include<unistd.h>
+#else
+#define SORT_HAS_GETPID 0
+#endif
 
 using namespace std;
 
 void insert_sort(int arr[], int len);//插入排序
 void swap(int* arr, int i, int j);//交换两个数
 void merge_sort(int arr[], int len);//归并排序
+void merge_sort_bottom_up(int arr[], int len);//非递归归并排序
 void process(int arr[], int left, int right);//归并排序的递归调用函数
 int small_process(int arr[], int left, int right);//小和问题调用的变体归并递归
 int* get_arr(int size);//获得动态数组
@@ -16,14 +49,67 @@ void merge_arr(int arr[], int left, int right);//归并排序的融合函数
 int merge_arr(int arr[], int left, int mid, int right);//小和问题的变体融合函数
 void small_sum(int arr[], int len);//小和问题
 void quick_sort(int arr[], int len);//快速排序（可解荷兰国旗问题）
-int* quick_partion(int arr[], int left, int right);//快速排序单次执行的任务
+pair<int, int> quick_partion(int arr[], int left, int right);//快速排序单次执行的任务，返回等于区域的边界
 void quick_process(int arr[], int left, int right);//快速排序递归
 void heap_sort(int arr[], int len);//堆排序
 void heap_insert(int arr[], int index);//向上调整
-void heapify(int arr[], int index, int heap_size);//向下调整
+void heapify(int arr[], int index, int heap_size);//向下调整，heap_size为堆中元素个数
 void count_sort(int arr[], int len);//计数排序
-void bucket_sort(int arr[], int len);//桶排序
-int count_num_max_len(int arr[], int len);//计算数组中最大数的长度（即有几位）
+void bucket_sort(int arr[], int len);//桶排序（基数排序）
+
+template<bool AllowFloat, typename RandomIt, typename Compare>
+void small_sort(RandomIt first, RandomIt last, Compare comp);//小区间排序，支持AVX2时使用排序网络
+template<typename InIt1, typename InIt2, typename OutIt, typename Compare>
+OutIt fast_merge(InIt1 first1, InIt1 last1, InIt2 first2, InIt2 last2, OutIt out, Compare comp);//融合两个有序段，支持AVX2时使用SIMD融合
+template<typename RandomIt, typename Compare>
+void merge_sort(RandomIt first, RandomIt last, Compare comp);//通用归并排序，只申请一次辅助空间
+template<typename RandomIt>
+void merge_sort(RandomIt first, RandomIt last);
+template<typename RandomIt, typename Compare>
+void merge_sort_bottom_up(RandomIt first, RandomIt last, Compare comp);//通用非递归归并排序
+template<typename RandomIt>
+void merge_sort_bottom_up(RandomIt first, RandomIt last);
+template<typename RandomIt>
+void parallel_merge_sort(RandomIt first, RandomIt last);//并行归并排序
+template<typename RandomIt>
+long long parallel_inversion_count(RandomIt first, RandomIt last);//并行逆序对统计
+template<typename RandomIt>
+long long parallel_small_sum(RandomIt first, RandomIt last);//并行小和问题
+template<typename T>
+void radix_sort(T* first, T* last);//基数排序，支持有符号/无符号整数和浮点数
+template<typename T, typename KeyOf>
+void radix_sort(T* first, T* last, KeyOf key_of);//按key_of取出的无符号键排序整条记录
+template<typename K, typename V>
+void radix_sort_pairs(K* keys, V* values, size_t len);//键和payload分开存放时按键排序
+template<typename T>
+void counting_sort(T* first, T* last);//计数排序，值域较大时退化为基数排序
+template<typename T, typename KeyOf>
+void counting_sort(T* first, T* last, KeyOf key_of);//按key_of取出的整数键稳定排序整条记录
+template<typename K, typename V>
+void counting_sort_pairs(K* keys, V* values, size_t len);//键和payload分开存放时按键稳定计数排序
+template<typename K>
+vector<size_t> argsort(const K* keys, size_t len);//求排好序后每个位置上原来的下标
+template<typename... Columns>
+void apply_permutation(const vector<size_t>& perm, Columns*... columns);//按排列原地重排若干列
+template<typename K, typename... Columns>
+void soa_sort(K* keys, size_t len, Columns*... columns);//按键列排序列存储的表
+template<typename RandomIt, typename Compare>
+void intro_sort(RandomIt first, RandomIt last, Compare comp);//内省排序，快速排序+堆排序+插入排序
+template<typename RandomIt>
+void intro_sort(RandomIt first, RandomIt last);
+template<typename RandomIt, typename Compare>
+void heap_sort(RandomIt first, RandomIt last, Compare comp);//通用堆排序
+int run_external_sort(int argc, char* argv[]);//外排序命令行入口
+void benchmark_heap_sort(size_t len);//比较d叉堆排序和标准库的堆排序
+template<typename RandomIt, typename Compare>
+void intro_select(RandomIt first, RandomIt nth, RandomIt last, Compare comp);//快速选择第nth小的数
+template<typename RandomIt, typename Compare>
+void partial_sort_select(RandomIt first, RandomIt middle, RandomIt last, Compare comp);//只排好最小的middle-first个数
+template<typename T>
+T filtered_select(const T* data, size_t len, size_t k);//不修改原数组求第k小
+template<typename RandomIt>
+void sample_sort(RandomIt first, RandomIt last);//并行样本排序
+int run_sort_benchmark(int argc, char* argv[]);//排序基准测试命令行入口
 
 void swap(int arr[], int i, int j){
 //	arr[i] = arr[i] ^ arr[j];
@@ -51,9 +137,7 @@ void merge_sort(int arr[], int len){
 	if(len <= 1){
 		return;
 	}
-	int right = len - 1;
-	int left = 0;
-	process(arr, left, right);
+	merge_sort(arr, arr + len);//不再每次融合都申请内存，process/merge_arr保留作为递归写法的参考
 	cout<<"done..."<<endl;
 }
 
@@ -107,6 +191,121 @@ int* get_arr(int size){
 	return p;
 }
 
+/*************************归并排序引擎*************************
+ * 上面的merge_arr每次融合都会malloc/free一个辅助数组，n个数就要申请O(n)次内存，数据量大时时间基本都花在申请内存上
+ * 下面的实现只在开始时申请一块和原数组等长的辅助空间，然后每一层交替地把原数组和辅助数组作为源和目标（ping-pong），
+ * 这样每一层只需要融合一次，不需要再把help拷贝回原数组
+ * 另外当区间长度小于MERGE_INSERT_CUTOFF时直接用插入排序，小数组上插入排序常数更小
+ * 所有函数都写成模板，可以用在任意随机访问迭代器和比较器上，并且是稳定排序
+ */
+const int MERGE_INSERT_CUTOFF = 32;//小于该长度的区间直接插入排序
+
+//通用插入排序（稳定），用作各种排序的小区间处理
+template<typename RandomIt, typename Compare>
+void insertion_sort(RandomIt first, RandomIt last, Compare comp){
+    if(last - first <= 1){
+        return;
+    }
+    for(RandomIt i = first + 1; i != last; ++i){
+        auto value = std::move(*i);
+        RandomIt j = i;
+        for(; j != first && comp(value, *(j - 1)); --j){
+            *j = std::move(*(j - 1));
+        }
+        *j = std::move(value);
+    }
+}
+
+//把[first1, last1)和[first2, last2)两个有序区间融合到out，相等时先取左边，保证稳定
+template<typename InIt1, typename InIt2, typename OutIt, typename Compare>
+OutIt merge_run(InIt1 first1, InIt1 last1, InIt2 first2, InIt2 last2, OutIt out, Compare comp){
+    while(first1 != last1 && first2 != last2){
+        if(comp(*first2, *first1)){
+            *out = std::move(*first2);
+            ++first2;
+        }
+        else{
+            *out = std::move(*first1);
+            ++first1;
+        }
+        ++out;
+    }
+    out = std::move(first1, last1, out);
+    return std::move(first2, last2, out);
+}
+
+//递归部分：把src中[0, len)排好序写入dst，两块空间在进入时内容相同，左右子问题交换src和dst的角色
+template<typename SrcIt, typename DstIt, typename Compare>
+void merge_sort_pingpong(SrcIt src, DstIt dst, ptrdiff_t len, Compare comp){
+    if(len <= MERGE_INSERT_CUTOFF){
+        small_sort<false>(dst, dst + len, comp);
+        return;
+    }
+    ptrdiff_t mid = len >> 1;
+    merge_sort_pingpong(dst, src, mid, comp);//左半边排好序写入src
+    merge_sort_pingpong(dst + mid, src + mid, len - mid, comp);//右半边排好序写入src
+    fast_merge(src, src + mid, src + mid, src + len, dst, comp);//再从src融合回dst
+}
+
+//通用归并排序（自顶向下），只申请一次辅助空间
+template<typename RandomIt, typename Compare>
+void merge_sort(RandomIt first, RandomIt last, Compare comp){
+    ptrdiff_t len = last - first;
+    if(len <= MERGE_INSERT_CUTOFF){
+        small_sort<false>(first, last, comp);
+        return;
+    }
+    typedef typename iterator_traits<RandomIt>::value_type value_type;
+    vector<value_type> buffer(first, last);//唯一的一次内存申请
+    merge_sort_pingpong(buffer.begin(), first, len, comp);
+}
+
+template<typename RandomIt>
+void merge_sort(RandomIt first, RandomIt last){
+    merge_sort(first, last, less<typename iterator_traits<RandomIt>::value_type>());
+}
+
+//通用归并排序（自底向上，非递归）
+//先把每MERGE_INSERT_CUTOFF个数插入排序，然后步长每次翻倍，在原数组和辅助数组之间来回融合
+template<typename RandomIt, typename Compare>
+void merge_sort_bottom_up(RandomIt first, RandomIt last, Compare comp){
+    ptrdiff_t len = last - first;
+    for(ptrdiff_t i = 0; i < len; i += MERGE_INSERT_CUTOFF){
+        small_sort<false>(first + i, first + min<ptrdiff_t>(i + MERGE_INSERT_CUTOFF, len), comp);
+    }
+    if(len <= MERGE_INSERT_CUTOFF){
+        return;
+    }
+    typedef typename iterator_traits<RandomIt>::value_type value_type;
+    vector<value_type> buffer(len);
+    bool in_buffer = false;//当前有序的数据在原数组还是在辅助数组中
+    for(ptrdiff_t width = MERGE_INSERT_CUTOFF; width < len; width <<= 1){
+        for(ptrdiff_t left = 0; left < len; left += 2 * width){
+            ptrdiff_t mid = min(left + width, len);
+            ptrdiff_t right = min(left + 2 * width, len);
+            if(in_buffer){
+                fast_merge(buffer.begin() + left, buffer.begin() + mid, buffer.begin() + mid, buffer.begin() + right, first + left, comp);
+            }
+            else{
+                fast_merge(first + left, first + mid, first + mid, first + right, buffer.begin() + left, comp);
+            }
+        }
+        in_buffer = !in_buffer;
+    }
+    if(in_buffer){
+        std::move(buffer.begin(), buffer.end(), first);
+    }
+}
+
+template<typename RandomIt>
+void merge_sort_bottom_up(RandomIt first, RandomIt last){
+    merge_sort_bottom_up(first, last, less<typename iterator_traits<RandomIt>::value_type>());
+}
+
+void merge_sort_bottom_up(int arr[], int len){
+    merge_sort_bottom_up(arr, arr + len);
+}
+
 //小和问题：统计一个数组中每个元素之前比该元素小的数的和
 //思路：使用归并排序的思想
 int small_process(int arr[], int left ,int right){
@@ -166,12 +365,320 @@ void small_sum(int arr[], int len){
 	cout<<"done..."<<endl;
 }
 
+/*************************线程池与并行归并排序*************************
+ * 上面的process/merge_arr和small_process都只能单线程递归
+ * 并行版本的思路：
+ *      1）递归时把左半边作为任务丢进线程池，当前线程处理右半边，区间小于PARALLEL_SORT_GRAIN后退化为串行的ping-pong归并
+ *      2）最后几层的融合是瓶颈（最后一次融合要处理全部n个数），所以融合也要并行：
+ *         取较长一段的中点，在另一段中二分找到它的位置（co-rank），两边的前半部分和后半部分就可以独立融合
+ *      3）小和、逆序对在融合前统计左右两段之间的贡献，左段切块后每块二分找起点，然后双指针线性统计，同样可以并行
+ * 线程池中等待的线程不会阻塞，而是去执行队列里的其他任务，所以递归fork不会因为线程都在等待而死锁
+ */
+const ptrdiff_t PARALLEL_SORT_GRAIN = 1 << 14;//小于该长度的区间不再拆分任务
+
+//一组任务的计数器，用于等待这一组任务全部完成
+class TaskGroup{
+    friend class ThreadPool;
+private:
+    atomic<long> pending;
+public:
+    TaskGroup() : pending(0) {}
+};
+
+class ThreadPool{
+private:
+    vector<thread> workers;
+    deque<function<void()>> tasks;
+    mutex task_lock;
+    condition_variable task_ready;
+    bool stopping;
+
+    bool pop_task(function<void()>& task){
+        lock_guard<mutex> guard(task_lock);
+        if(tasks.empty()){
+            return false;
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+        return true;
+    }
+
+    void worker_loop(){
+        while(true){
+            function<void()> task;
+            {
+                unique_lock<mutex> guard(task_lock);
+                task_ready.wait(guard, [this]{ return stopping || !tasks.empty(); });
+                if(tasks.empty()){//stopping且没有任务了
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit ThreadPool(unsigned thread_num) : stopping(false) {
+        for(unsigned i = 0; i < thread_num; i++){
+            workers.emplace_back([this]{ worker_loop(); });
+        }
+    }
+
+    ~ThreadPool(){
+        {
+            lock_guard<mutex> guard(task_lock);
+            stopping = true;
+        }
+        task_ready.notify_all();
+        for(auto& worker : workers){
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //参与计算的线程数（工作线程加上调用wait的线程）
+    unsigned concurrency() const {
+        return (unsigned)workers.size() + 1;
+    }
+
+    template<typename F>
+    void run(TaskGroup& group, F f){
+        group.pending++;
+        {
+            lock_guard<mutex> guard(task_lock);
+            tasks.emplace_back([&group, f]{
+                f();
+                group.pending--;
+            });
+        }
+        task_ready.notify_one();
+    }
+
+    //等待group中的任务完成，等待期间帮忙执行队列中的任务
+    void wait(TaskGroup& group){
+        while(group.pending.load() != 0){
+            function<void()> task;
+            if(pop_task(task)){
+                task();
+            }
+            else{
+                this_thread::yield();
+            }
+        }
+    }
+
+    //全局线程池，调用线程也参与计算，所以工作线程数为核数减一
+    static ThreadPool& instance(){
+        static ThreadPool pool(thread::hardware_concurrency() > 1 ? thread::hardware_concurrency() - 1 : 0);
+        return pool;
+    }
+};
+
+//把[begin, end)切成不小于grain的若干块并行执行f(lo, hi)
+template<typename F>
+void parallel_for(size_t begin, size_t end, size_t grain, F f, ThreadPool& pool = ThreadPool::instance()){
+    if(end <= begin){
+        return;
+    }
+    size_t chunk_num = min<size_t>((end - begin + grain - 1) / grain, (size_t)pool.concurrency() * 4);
+    if(chunk_num <= 1){
+        f(begin, end);
+        return;
+    }
+    size_t chunk = (end - begin + chunk_num - 1) / chunk_num;
+    TaskGroup group;
+    for(size_t lo = begin + chunk; lo < end; lo += chunk){
+        size_t hi = min(lo + chunk, end);
+        pool.run(group, [lo, hi, &f]{ f(lo, hi); });
+    }
+    f(begin, min(begin + chunk, end));
+    pool.wait(group);
+}
+
+//并行融合：按co-rank把两个有序段切成前后两部分，分别融合
+template<typename It1, typename It2, typename OutIt, typename Compare>
+void parallel_merge(It1 first1, It1 last1, It2 first2, It2 last2, OutIt out, Compare comp, ThreadPool& pool){
+    ptrdiff_t len1 = last1 - first1;
+    ptrdiff_t len2 = last2 - first2;
+    if(len1 + len2 <= PARALLEL_SORT_GRAIN){
+        fast_merge(first1, last1, first2, last2, out, comp);
+        return;
+    }
+    It1 mid1;
+    It2 mid2;
+    if(len1 >= len2){//左段中点之前的、右段中严格小于它的，都排在它前面
+        mid1 = first1 + len1 / 2;
+        mid2 = lower_bound(first2, last2, *mid1, comp);
+    }
+    else{//右段中点之前的、左段中小于等于它的，都排在它前面（保证稳定）
+        mid2 = first2 + len2 / 2;
+        mid1 = upper_bound(first1, last1, *mid2, comp);
+    }
+    OutIt mid_out = out + (mid1 - first1) + (mid2 - first2);
+    TaskGroup group;
+    pool.run(group, [=, &pool]{ parallel_merge(first1, mid1, first2, mid2, out, comp, pool); });
+    parallel_merge(mid1, last1, mid2, last2, mid_out, comp, pool);
+    pool.wait(group);
+}
+
+//只排序不统计
+struct NoCrossCount{
+    template<typename It>
+    long long leaf(It, It) const { return 0; }
+    template<typename It1, typename It2>
+    long long cross(It1, It1, It2, It2) const { return 0; }
+};
+
+//逆序对：i < j 且 arr[i] > arr[j]
+template<typename Compare>
+struct InversionCount{
+    Compare comp;
+    explicit InversionCount(Compare c) : comp(c) {}
+    //小区间直接枚举
+    template<typename It>
+    long long leaf(It first, It last) const {
+        long long count = 0;
+        for(It i = first; i != last; ++i){
+            for(It j = i + 1; j != last; ++j){
+                count += comp(*j, *i) ? 1 : 0;
+            }
+        }
+        return count;
+    }
+    //左段[l, l_end)中每个数与整个右段的贡献：右段中严格比它小的个数
+    template<typename It1, typename It2>
+    long long cross(It1 l, It1 l_end, It2 r, It2 r_end) const {
+        long long count = 0;
+        It2 p = lower_bound(r, r_end, *l, comp);
+        for(; l != l_end; ++l){
+            while(p != r_end && comp(*p, *l)){
+                ++p;
+            }
+            count += p - r;
+        }
+        return count;
+    }
+};
+
+//小和：i < j 且 arr[i] < arr[j] 时累加 arr[i]
+struct SmallSumCount{
+    template<typename It>
+    long long leaf(It first, It last) const {
+        long long sum = 0;
+        for(It i = first; i != last; ++i){
+            for(It j = i + 1; j != last; ++j){
+                sum += *i < *j ? (long long)*i : 0;
+            }
+        }
+        return sum;
+    }
+    //左段中每个数乘以右段中严格比它大的个数
+    template<typename It1, typename It2>
+    long long cross(It1 l, It1 l_end, It2 r, It2 r_end) const {
+        long long sum = 0;
+        It2 p = upper_bound(r, r_end, *l);
+        for(; l != l_end; ++l){
+            while(p != r_end && !(*l < *p)){
+                ++p;
+            }
+            sum += (long long)*l * (r_end - p);
+        }
+        return sum;
+    }
+};
+
+//统计左右两个有序段之间的贡献，左段切块并行
+template<typename It, typename Counter>
+long long parallel_cross_count(It left, ptrdiff_t left_len, It right, ptrdiff_t right_len, const Counter& counter, ThreadPool& pool){
+    if(left_len + right_len <= PARALLEL_SORT_GRAIN){
+        return counter.cross(left, left + left_len, right, right + right_len);
+    }
+    atomic<long long> total(0);
+    parallel_for(0, (size_t)left_len, (size_t)PARALLEL_SORT_GRAIN, [&](size_t lo, size_t hi){
+        total += counter.cross(left + lo, left + hi, right, right + right_len);
+    }, pool);
+    return total.load();
+}
+
+//并行ping-pong归并：把src中[0, len)排好序写入dst，返回counter统计的结果
+template<typename SrcIt, typename DstIt, typename Compare, typename Counter>
+long long parallel_sort_process(SrcIt src, DstIt dst, ptrdiff_t len, Compare comp, const Counter& counter, ThreadPool& pool){
+    if(len <= MERGE_INSERT_CUTOFF){
+        long long count = counter.leaf(dst, dst + len);
+        small_sort<false>(dst, dst + len, comp);
+        return count;
+    }
+    ptrdiff_t mid = len >> 1;
+    long long left_count = 0;
+    long long right_count = 0;
+    if(len > PARALLEL_SORT_GRAIN){
+        TaskGroup group;
+        pool.run(group, [&]{ left_count = parallel_sort_process(dst, src, mid, comp, counter, pool); });
+        right_count = parallel_sort_process(dst + mid, src + mid, len - mid, comp, counter, pool);
+        pool.wait(group);
+    }
+    else{
+        left_count = parallel_sort_process(dst, src, mid, comp, counter, pool);
+        right_count = parallel_sort_process(dst + mid, src + mid, len - mid, comp, counter, pool);
+    }
+    long long cross_count = parallel_cross_count(src, mid, src + mid, len - mid, counter, pool);
+    parallel_merge(src, src + mid, src + mid, src + len, dst, comp, pool);
+    return left_count + right_count + cross_count;
+}
+
+template<typename RandomIt, typename Compare, typename Counter>
+long long parallel_merge_sort_count(RandomIt first, RandomIt last, Compare comp, const Counter& counter, ThreadPool& pool){
+    ptrdiff_t len = last - first;
+    if(len <= 1){
+        return 0;
+    }
+    typedef typename iterator_traits<RandomIt>::value_type value_type;
+    vector<value_type> buffer(len);
+    parallel_for(0, (size_t)len, (size_t)PARALLEL_SORT_GRAIN, [&](size_t lo, size_t hi){//并行拷贝，顺便把内存页分配到各个线程
+        std::copy(first + lo, first + hi, buffer.begin() + lo);
+    }, pool);
+    return parallel_sort_process(buffer.begin(), first, len, comp, counter, pool);
+}
+
+//并行归并排序（稳定）
+template<typename RandomIt, typename Compare>
+void parallel_merge_sort(RandomIt first, RandomIt last, Compare comp, ThreadPool& pool){
+    parallel_merge_sort_count(first, last, comp, NoCrossCount(), pool);
+}
+
+template<typename RandomIt, typename Compare>
+void parallel_merge_sort(RandomIt first, RandomIt last, Compare comp){
+    parallel_merge_sort(first, last, comp, ThreadPool::instance());
+}
+
+template<typename RandomIt>
+void parallel_merge_sort(RandomIt first, RandomIt last){
+    parallel_merge_sort(first, last, less<typename iterator_traits<RandomIt>::value_type>());
+}
+
+//并行统计逆序对个数，统计完成后数组有序
+template<typename RandomIt>
+long long parallel_inversion_count(RandomIt first, RandomIt last){
+    typedef less<typename iterator_traits<RandomIt>::value_type> compare_type;
+    return parallel_merge_sort_count(first, last, compare_type(), InversionCount<compare_type>(compare_type()), ThreadPool::instance());
+}
+
+//并行计算小和，统计完成后数组有序
+template<typename RandomIt>
+long long parallel_small_sum(RandomIt first, RandomIt last){
+    return parallel_merge_sort_count(first, last, less<typename iterator_traits<RandomIt>::value_type>(), SmallSumCount(), ThreadPool::instance());
+}
+
 //快速排序（可解荷兰国旗问题）
 void quick_sort(int arr[], int len){
 	if(len<=1){
 		return;
 	}
-	quick_process(arr, 0, len-1);
+	intro_sort(arr, arr + len);//quick_process在有序、构造数据上会退化，改用内省排序
 	cout<<"done..."<<endl;
 }
 
@@ -206,7 +713,7 @@ void quick_sort(int arr[], int len){
 //	return p;
 //}
 
-int* quick_partion(int arr[], int left, int right){
+pair<int, int> quick_partion(int arr[], int left, int right){
 	int less = left - 1;
 	int more = right;
 	int p = left;
@@ -223,38 +730,339 @@ int* quick_partion(int arr[], int left, int right){
 	}
 	swap(arr, more, right);
 //	int bound[]={less+1, more}; //不能这样写，因为bound在栈上，出了函数作用域就会销毁
-    int* bound = get_arr(2);
-    bound[0] = less + 1;
-    bound[1] = more;
-	return bound;
+	return make_pair(less + 1, more);//按值返回边界，不再为每次partition申请内存
 }
 
 void quick_process(int arr[], int left, int right){
 	if(left < right){
 		int rand_num = ((rand() % 99)/100.0)* (right - left + 1);
 		swap(arr, rand_num+left, right);
-		int* p = quick_partion(arr, left, right);
-		quick_process(arr, left, p[0] - 1);
-		quick_process(arr, p[1] + 1, right);
+		pair<int, int> p = quick_partion(arr, left, right);
+		quick_process(arr, left, p.first - 1);
+		quick_process(arr, p.second + 1, right);
 	}
 }
 
-//堆排序
-void heap_sort(int arr[], int len){
+/*************************内省排序（introsort）*************************
+ * 上面的quick_sort存在几个问题：每次partition都要申请一块内存返回边界、递归深度没有上限、小数组也一直递归下去，
+ * 遇到已经有序或者特意构造的数据时会退化成O(n^2)
+ * intro_sort在快速排序的基础上做了以下改进（参考pattern-defeating quicksort的思路）：
+ *      1）选择pivot：长度小于INTRO_NINTHER_THRESHOLD时取首、中、尾三个数的中位数，否则取九个数的中位数（ninther）
+ *      2）对于整数、浮点数这种比较很便宜的类型，使用分块的无分支partition：先把一块中需要交换的位置记录在偏移数组里，
+ *         再统一交换，比较结果直接加到计数上，避免了分支预测失败
+ *      3）如果pivot和左边相邻的元素（上一次的pivot）相等，说明重复值很多，此时用三路partition（荷兰国旗问题），
+ *         等于pivot的区域直接跳过不再递归
+ *      4）如果partition之后两边非常不平衡，就打乱几个元素；不平衡的次数超过log(n)次，直接改用堆排序，保证O(nlogn)
+ *      5）如果partition时没有发生交换，说明数组可能基本有序，尝试有限步数的插入排序，成功就直接返回
+ *      6）长度小于INTRO_INSERT_CUTOFF时用插入排序
+ * 整个过程不申请堆内存，只递归较小的一边，循环处理较大的一边
+ */
+const ptrdiff_t INTRO_INSERT_CUTOFF = 24;//小于该长度直接插入排序
+const ptrdiff_t INTRO_NINTHER_THRESHOLD = 128;//大于该长度用九数取中
+const ptrdiff_t PARTIAL_INSERT_LIMIT = 8;//尝试插入排序时最多允许移动的元素个数
+const ptrdiff_t PARTITION_BLOCK_SIZE = 64;//无分支partition每一块的大小
+
+//把*a、*b、*c三个数排好序
+template<typename RandomIt, typename Compare>
+void sort3(RandomIt a, RandomIt b, RandomIt c, Compare comp){
+    if(comp(*b, *a)){
+        iter_swap(a, b);
+    }
+    if(comp(*c, *b)){
+        iter_swap(b, c);
+    }
+    if(comp(*b, *a)){
+        iter_swap(a, b);
+    }
+}
+
+//插入排序，移动次数超过PARTIAL_INSERT_LIMIT就放弃并返回false
+template<typename RandomIt, typename Compare>
+bool partial_insertion_sort(RandomIt first, RandomIt last, Compare comp){
+    if(last - first <= 1){
+        return true;
+    }
+    ptrdiff_t moved = 0;
+    for(RandomIt i = first + 1; i != last; ++i){
+        if(!comp(*i, *(i - 1))){
+            continue;
+        }
+        auto value = std::move(*i);
+        RandomIt j = i;
+        do{
+            *j = std::move(*(j - 1));
+            --j;
+        }while(j != first && comp(value, *(j - 1)));
+        *j = std::move(value);
+        moved += i - j;
+        if(moved > PARTIAL_INSERT_LIMIT){
+            return false;
+        }
+    }
+    return true;
+}
+
+//三路partition（荷兰国旗问题），返回等于pivot的区域[lt, gt)，不需要申请内存
+template<typename RandomIt, typename T, typename Compare>
+pair<RandomIt, RandomIt> partition_three_way(RandomIt first, RandomIt last, const T& pivot, Compare comp){
+    RandomIt lt = first;//[first, lt)小于pivot
+    RandomIt gt = last;//[gt, last)大于pivot
+    RandomIt p = first;
+    while(p < gt){
+        if(comp(*p, pivot)){
+            iter_swap(lt++, p++);
+        }
+        else if(comp(pivot, *p)){
+            iter_swap(p, --gt);
+        }
+        else{
+            p++;
+        }
+    }
+    return make_pair(lt, gt);
+}
+
+//以*first为pivot做partition，小于pivot的放左边，大于等于的放右边，返回pivot最终的位置
+//已经选过三数中位数，右侧一定存在不小于pivot的数，所以向右的扫描不需要检查边界
+template<typename RandomIt, typename Compare>
+pair<RandomIt, bool> partition_right(RandomIt first, RandomIt last, Compare comp){
+    auto pivot = std::move(*first);
+    RandomIt left = first;
+    RandomIt right = last;
+    while(comp(*++left, pivot));
+    if(left - 1 == first){
+        while(left < right && !comp(*--right, pivot));
+    }
+    else{
+        while(!comp(*--right, pivot));
+    }
+    bool already_partitioned = left >= right;//没有需要交换的元素
+    while(left < right){
+        iter_swap(left, right);
+        while(comp(*++left, pivot));
+        while(!comp(*--right, pivot));
+    }
+    RandomIt pivot_pos = left - 1;
+    *first = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return make_pair(pivot_pos, already_partitioned);
+}
+
+//按偏移数组交换左右两块中放错位置的元素，数量相同时直接交换，否则用轮换减少一半的写操作
+template<typename RandomIt>
+void swap_block_offsets(RandomIt left_base, RandomIt right_base, unsigned char* left_offsets, unsigned char* right_offsets, ptrdiff_t num, bool use_swaps){
+    if(use_swaps){
+        for(ptrdiff_t i = 0; i < num; i++){
+            iter_swap(left_base + left_offsets[i], right_base - right_offsets[i]);
+        }
+    }
+    else if(num > 0){
+        RandomIt l = left_base + left_offsets[0];
+        RandomIt r = right_base - right_offsets[0];
+        auto temp = std::move(*l);
+        *l = std::move(*r);
+        for(ptrdiff_t i = 1; i < num; i++){
+            l = left_base + left_offsets[i];
+            *r = std::move(*l);
+            r = right_base - right_offsets[i];
+            *l = std::move(*r);
+        }
+        *r = std::move(temp);
+    }
+}
+
+//分块的无分支partition，语义和partition_right相同
+template<typename RandomIt, typename Compare>
+pair<RandomIt, bool> partition_right_block(RandomIt first, RandomIt last, Compare comp){
+    auto pivot = std::move(*first);
+    RandomIt left = first;
+    RandomIt right = last;
+    while(comp(*++left, pivot));
+    if(left - 1 == first){
+        while(left < right && !comp(*--right, pivot));
+    }
+    else{
+        while(!comp(*--right, pivot));
+    }
+    bool already_partitioned = left >= right;
+    if(!already_partitioned){
+        iter_swap(left, right);
+        ++left;
+
+        unsigned char left_offsets[PARTITION_BLOCK_SIZE];
+        unsigned char right_offsets[PARTITION_BLOCK_SIZE];
+        RandomIt left_base = left;
+        RandomIt right_base = right;
+        ptrdiff_t left_num = 0, right_num = 0, left_start = 0, right_start = 0;
+        while(left < right){
+            //左右两边都还有未处理的元素时各取一块，剩余不足两块时平分
+            ptrdiff_t unknown = right - left;
+            ptrdiff_t left_split = left_num == 0 ? (right_num == 0 ? unknown / 2 : unknown) : 0;
+            ptrdiff_t right_split = right_num == 0 ? (unknown - left_split) : 0;
+
+            //记录左边块中大于等于pivot的偏移，比较结果直接累加，没有分支
+            ptrdiff_t left_scan = min(left_split, PARTITION_BLOCK_SIZE);
+            for(ptrdiff_t i = 0; i < left_scan;){
+                left_offsets[left_num] = (unsigned char)i++;
+                left_num += !comp(*left, pivot);
+                ++left;
+            }
+            //记录右边块中小于pivot的偏移
+            ptrdiff_t right_scan = min(right_split, PARTITION_BLOCK_SIZE);
+            for(ptrdiff_t i = 0; i < right_scan;){
+                right_offsets[right_num] = (unsigned char)++i;
+                right_num += comp(*--right, pivot);
+            }
+
+            ptrdiff_t num = min(left_num, right_num);
+            swap_block_offsets(left_base, right_base, left_offsets + left_start, right_offsets + right_start, num, left_num == right_num);
+            left_num -= num;
+            right_num -= num;
+            left_start += num;
+            right_start += num;
+            if(left_num == 0){
+                left_start = 0;
+                left_base = left;
+            }
+            if(right_num == 0){
+                right_start = 0;
+                right_base = right;
+            }
+        }
+
+        //某一边还剩下放错的元素，把它们依次交换到中间
+        if(left_num){
+            while(left_num--){
+                iter_swap(left_base + left_offsets[left_start + left_num], --right);
+            }
+            left = right;
+        }
+        if(right_num){
+            while(right_num--){
+                iter_swap(right_base - right_offsets[right_start + right_num], left);
+                ++left;
+            }
+        }
+    }
+    RandomIt pivot_pos = left - 1;
+    *first = std::move(*pivot_pos);
+    *pivot_pos = std::move(pivot);
+    return make_pair(pivot_pos, already_partitioned);
+}
+
+//比较便宜的类型（算术类型配合默认比较器）才使用无分支partition
+template<typename T, typename Compare>
+struct use_block_partition : integral_constant<bool, is_arithmetic<T>::value &&
+        (is_same<Compare, less<T>>::value || is_same<Compare, greater<T>>::value)> {};
+
+//选pivot并放到first的位置
+template<typename RandomIt, typename Compare>
+void choose_pivot(RandomIt first, RandomIt last, Compare comp){
+    ptrdiff_t len = last - first;
+    ptrdiff_t half = len / 2;
+    if(len > INTRO_NINTHER_THRESHOLD){
+        sort3(first, first + half, last - 1, comp);
+        sort3(first + 1, first + (half - 1), last - 2, comp);
+        sort3(first + 2, first + (half + 1), last - 3, comp);
+        sort3(first + (half - 1), first + half, first + (half + 1), comp);
+        iter_swap(first, first + half);
+    }
+    else{
+        sort3(first + half, first, last - 1, comp);
+    }
+}
+
+//不平衡时打乱几个位置，破坏构造出来的坏数据
+template<typename RandomIt>
+void break_patterns(RandomIt first, RandomIt last){
+    ptrdiff_t len = last - first;
+    if(len >= INTRO_INSERT_CUTOFF){
+        iter_swap(first, first + len / 4);
+        iter_swap(last - 1, last - len / 4);
+        if(len > INTRO_NINTHER_THRESHOLD){
+            iter_swap(first + 1, first + (len / 4 + 1));
+            iter_swap(first + 2, first + (len / 4 + 2));
+            iter_swap(last - 2, last - (len / 4 + 1));
+            iter_swap(last - 3, last - (len / 4 + 2));
+        }
+    }
+}
+
+template<typename RandomIt, typename Compare, bool Block>
+void intro_sort_loop(RandomIt first, RandomIt last, Compare comp, int bad_allowed, bool leftmost){
+    while(true){
+        ptrdiff_t len = last - first;
+        if(len < INTRO_INSERT_CUTOFF){
+            small_sort<true>(first, last, comp);
+            return;
+        }
+
+        choose_pivot(first, last, comp);
+
+        //pivot和左边的元素（之前某一次的pivot，不大于当前区间的所有数）相等，说明有大量重复值
+        //三路partition后等于pivot的部分已经就位，只需要继续处理大于pivot的部分
+        if(!leftmost && !comp(*(first - 1), *first)){
+            auto pivot = *first;
+            first = partition_three_way(first, last, pivot, comp).second;
+            continue;
+        }
+
+        pair<RandomIt, bool> result = Block ? partition_right_block(first, last, comp) : partition_right(first, last, comp);
+        RandomIt pivot_pos = result.first;
+        ptrdiff_t left_len = pivot_pos - first;
+        ptrdiff_t right_len = last - (pivot_pos + 1);
+
+        if(left_len < len / 8 || right_len < len / 8){//两边非常不平衡
+            if(--bad_allowed == 0){
+                heap_sort(first, last, comp);
+                return;
+            }
+            break_patterns(first, pivot_pos);
+            break_patterns(pivot_pos + 1, last);
+        }
+        else if(result.second && partial_insertion_sort(first, pivot_pos, comp) && partial_insertion_sort(pivot_pos + 1, last, comp)){
+            return;//没有发生交换且两边都基本有序
+        }
+
+        //递归较短的一边，循环处理较长的一边，栈深度不超过log(n)
+        if(left_len < right_len){
+            intro_sort_loop<RandomIt, Compare, Block>(first, pivot_pos, comp, bad_allowed, leftmost);
+            first = pivot_pos + 1;
+            leftmost = false;
+        }
+        else{
+            intro_sort_loop<RandomIt, Compare, Block>(pivot_pos + 1, last, comp, bad_allowed, false);
+            last = pivot_pos;
+        }
+    }
+}
+
+//内省排序（不稳定）
+template<typename RandomIt, typename Compare>
+void intro_sort(RandomIt first, RandomIt last, Compare comp){
+    typedef typename iterator_traits<RandomIt>::value_type value_type;
+    ptrdiff_t len = last - first;
     if(len <= 1){
         return;
     }
-    //先使用向上调整，使数组成为堆
-    for(int i = 0; i < len; i++){
-        heap_insert(arr, i);
+    int log_len = 0;
+    while((len >> log_len) > 1){
+        log_len++;
     }
-    //使用向下调整，进行排序
-    int heap_size = len;
-    while(heap_size > 0){
-        swap(arr, heap_size - 1, 0);
-        heap_size--;
-        heapify(arr, 0, heap_size-1);
+    intro_sort_loop<RandomIt, Compare, use_block_partition<value_type, Compare>::value>(first, last, comp, log_len, true);
+}
+
+template<typename RandomIt>
+void intro_sort(RandomIt first, RandomIt last){
+    intro_sort(first, last, less<typename iterator_traits<RandomIt>::value_type>());
+}
+
+//堆排序
+void heap_sort(int arr[], int len){
+    if(len <= 1){
+        return;
     }
+    heap_sort(arr, arr + len, less<int>());//4叉堆，Floyd建堆+自底向上调整，见下面d叉堆的部分
 }
 
 //向上调整
@@ -265,110 +1073,2161 @@ void heap_insert(int arr[], int index){
     }
 }
 
-//向下调整
+//向下调整，heap_size为堆中元素的个数（原来传入的是最后一个元素的下标，容易差一）
 void heapify(int arr[], int index, int heap_size){
     int left = index * 2 + 1;
-    int largest = (left + 1) <= heap_size && arr[left] < arr[left + 1] ? (left + 1) : left;
-    while(arr[index] < arr[largest]){
-        if (left > heap_size){ //如果没有孩子了，就跳出循环
+    while(left < heap_size){//如果没有孩子了，就跳出循环
+        int largest = (left + 1) < heap_size && arr[left + 1] > arr[left] ? (left + 1) : left;
+        largest = arr[largest] > arr[index] ? largest : index;
+        if(largest == index){
             break;
         }
-        swap(arr, index, largest);
+        swap(arr, largest, index);
         index = largest;
         left = index * 2 + 1;
-        if (left > heap_size){ //如果没有孩子了，就跳出循环
-            break;
-        }
-        if((left + 1) <= heap_size){
-            largest = arr[left] > arr[left + 1] ? left : (left + 1);
-        }
-        else{
-            largest = left;
+    }
+}
+
+/*************************SIMD排序网络*************************
+ * 所有排序到最后都落到插入排序上，一次只比较交换一对数
+ * 对于int32和float，可以用AVX2一次对8个数做min/max，一个寄存器中的8个数用双调排序网络（bitonic sort）排好，
+ * 多个寄存器之间再用双调融合网络两两融合，这样8/16/32/64个数的排序完全没有分支
+ *      1）寄存器内排序：6步，每一步把寄存器打乱得到配对的元素，min/max后按方向混合（blend）
+ *      2）两段各k个寄存器的有序序列融合：把第二段整体逆序，和第一段对应位置做min/max，得到两段双调序列，
+ *         再对每一段依次做寄存器间距离为k/2...1的比较交换，最后做寄存器内距离为4、2、1的比较交换
+ *      3）两个有序数组的融合也用同样的8+8融合核心，每次输出较小的8个数，较大的8个留在寄存器中继续融合
+ * 是否支持AVX2在运行时通过CPUID判断，不支持时退回插入排序/普通融合，同一个程序在任何机器上都能运行
+ * 浮点数的-0.0和0.0在min/max下可能交换顺序，所以稳定的归并排序只对int32使用SIMD，内省排序对int32和float都使用
+ */
+const size_t SIMD_SORT_MAX = 64;//排序网络最多处理的元素个数（8个寄存器）
+
+//运行时检测CPU是否支持AVX2，只检测一次
+inline bool cpu_has_avx2(){
+#if SORT_HAS_AVX2_KERNEL
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+#if SORT_HAS_AVX2_KERNEL
+//寄存器一律按__m256i存放，只有min/max区分整数和浮点数
+struct Avx2Int32{
+    typedef int value_type;
+    __attribute__((target("avx2"))) static __m256i vmin(__m256i a, __m256i b){ return _mm256_min_epi32(a, b); }
+    __attribute__((target("avx2"))) static __m256i vmax(__m256i a, __m256i b){ return _mm256_max_epi32(a, b); }
+    static int pad(){ return numeric_limits<int>::max(); }
+};
+
+struct Avx2Float{
+    typedef float value_type;
+    __attribute__((target("avx2"))) static __m256i vmin(__m256i a, __m256i b){
+        return _mm256_castps_si256(_mm256_min_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b)));
+    }
+    __attribute__((target("avx2"))) static __m256i vmax(__m256i a, __m256i b){
+        return _mm256_castps_si256(_mm256_max_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b)));
+    }
+    static float pad(){ return numeric_limits<float>::infinity(); }
+};
+
+//寄存器内距离为4、2、1的配对
+__attribute__((target("avx2"))) inline __m256i simd_partner4(__m256i v){ return _mm256_permute2x128_si256(v, v, 1); }
+__attribute__((target("avx2"))) inline __m256i simd_partner2(__m256i v){ return _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)); }
+__attribute__((target("avx2"))) inline __m256i simd_partner1(__m256i v){ return _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)); }
+
+//对一个寄存器做一步比较交换，Mask中为1的位置取较大值
+#define SIMD_SORT_STEP(Ops, v, partner, Mask) \
+    do{ \
+        __m256i p = partner(v); \
+        v = _mm256_blend_epi32(Ops::vmin(v, p), Ops::vmax(v, p), Mask); \
+    }while(0)
+
+//寄存器内8个数的双调排序
+template<typename Ops>
+__attribute__((target("avx2"))) inline __m256i simd_sort_register(__m256i v){
+    SIMD_SORT_STEP(Ops, v, simd_partner1, 0x66);
+    SIMD_SORT_STEP(Ops, v, simd_partner2, 0x3C);
+    SIMD_SORT_STEP(Ops, v, simd_partner1, 0x5A);
+    SIMD_SORT_STEP(Ops, v, simd_partner4, 0xF0);
+    SIMD_SORT_STEP(Ops, v, simd_partner2, 0xCC);
+    SIMD_SORT_STEP(Ops, v, simd_partner1, 0xAA);
+    return v;
+}
+
+//寄存器内的双调序列整理成升序
+template<typename Ops>
+__attribute__((target("avx2"))) inline __m256i simd_clean_register(__m256i v){
+    SIMD_SORT_STEP(Ops, v, simd_partner4, 0xF0);
+    SIMD_SORT_STEP(Ops, v, simd_partner2, 0xCC);
+    SIMD_SORT_STEP(Ops, v, simd_partner1, 0xAA);
+    return v;
+}
+
+__attribute__((target("avx2"))) inline __m256i simd_reverse_register(__m256i v){
+    return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+//融合regs[0, k)和regs[k, 2k)两段有序序列（每段k个寄存器）
+template<typename Ops>
+__attribute__((target("avx2"))) inline void simd_merge_registers(__m256i* regs, int k){
+    __m256i* second = regs + k;
+    for(int i = 0; i < k / 2; i++){
+        __m256i temp = second[i];
+        second[i] = second[k - 1 - i];
+        second[k - 1 - i] = temp;
+    }
+    for(int i = 0; i < k; i++){
+        __m256i b = simd_reverse_register(second[i]);
+        second[i] = Ops::vmax(regs[i], b);
+        regs[i] = Ops::vmin(regs[i], b);
+    }
+    for(int half = 0; half < 2 * k; half += k){
+        for(int d = k / 2; d >= 1; d /= 2){
+            for(int i = half; i < half + k; i++){
+                if(((i - half) & d) == 0){
+                    __m256i low = Ops::vmin(regs[i], regs[i + d]);
+                    regs[i + d] = Ops::vmax(regs[i], regs[i + d]);
+                    regs[i] = low;
+                }
+            }
         }
     }
-//简洁的代码
-//    int left = index * 2 + 1;
-//    while(left < heap_size){
-//        int largest = (left + 1) <= heap_size && arr[left] > arr[left + 1] ? left : (left + 1);
-//        largest = arr[largest] > arr[index] ? largest : index;
-//        if(largest == index){
-//            break;
-//        }
-//        swap(arr, largest, index);
-//        index = largest;
-//        left = index * 2 + 1;
-//    }
+    for(int i = 0; i < 2 * k; i++){
+        regs[i] = simd_clean_register<Ops>(regs[i]);
+    }
 }
 
-//计数排序
-void count_sort(int arr[], int len){
-    if(len <= 1){
-        return;
+//用排序网络排序不超过64个数
+template<typename Ops>
+__attribute__((target("avx2"))) void simd_sort_small_avx2(typename Ops::value_type* data, size_t len){
+    typedef typename Ops::value_type value_type;
+    int reg_num = 1;
+    while((size_t)reg_num * 8 < len){
+        reg_num *= 2;
+    }
+    alignas(32) value_type temp[SIMD_SORT_MAX];
+    for(size_t i = 0; i < len; i++){
+        temp[i] = data[i];
     }
-    int bucket[10];
-    for(int i = 0; i < 10; i++){
-        bucket[i] = 0;
+    for(size_t i = len; i < (size_t)reg_num * 8; i++){
+        temp[i] = Ops::pad();//用最大值补齐，排序后位于末尾
     }
-    for(int i = 0; i < len; i++){
-        int value = arr[i];
-        bucket[value]++;
+    __m256i regs[SIMD_SORT_MAX / 8];
+    for(int i = 0; i < reg_num; i++){
+        regs[i] = simd_sort_register<Ops>(_mm256_load_si256((const __m256i*)(temp + i * 8)));
     }
-    int index = 0;
-    for(int j = 0; j < 10; j++){
-        while(bucket[j] != 0){
-            arr[index] = j;
-            bucket[j]--;
-            index++;
+    for(int run = 1; run < reg_num; run *= 2){
+        for(int base = 0; base < reg_num; base += 2 * run){
+            simd_merge_registers<Ops>(regs + base, run);
         }
     }
+    for(int i = 0; i < reg_num; i++){
+        _mm256_store_si256((__m256i*)(temp + i * 8), regs[i]);
+    }
+    for(size_t i = 0; i < len; i++){
+        data[i] = temp[i];
+    }
 }
 
-//桶排序
-void bucket_sort(int arr[], int len){
-    int max_len = count_num_max_len(arr, len);
-    int* help = new int[len];
-    for(int i = 0; i < max_len; i++){//根据最大数的长度进行循环
-        int bucket[10] = {0};
-        //根据该位上的数字进行统计
-        for(int j = 0; j < len; j++){
-            int element = int(arr[j] / (pow(10, i)));
-            bucket[element % 10]++;
+//融合两个有序数组，每次用8+8的融合网络输出8个数
+template<typename Ops>
+__attribute__((target("avx2"))) void simd_merge_avx2(const typename Ops::value_type* a, size_t len_a,
+        const typename Ops::value_type* b, size_t len_b, typename Ops::value_type* out){
+    typedef typename Ops::value_type value_type;
+    __m256i regs[2];
+    regs[0] = _mm256_loadu_si256((const __m256i*)a);
+    regs[1] = _mm256_loadu_si256((const __m256i*)b);
+    size_t ia = 8, ib = 8;
+    while(true){
+        simd_merge_registers<Ops>(regs, 1);
+        _mm256_storeu_si256((__m256i*)out, regs[0]);//较小的8个数已经确定
+        out += 8;
+        regs[0] = regs[1];
+        //下一块从队头较小的数组中取，不足8个时交给标量处理
+        bool take_a = ib >= len_b || (ia < len_a && !(b[ib] < a[ia]));
+        if(take_a && ia + 8 <= len_a){
+            regs[1] = _mm256_loadu_si256((const __m256i*)(a + ia));
+            ia += 8;
+        }
+        else if(!take_a && ib + 8 <= len_b){
+            regs[1] = _mm256_loadu_si256((const __m256i*)(b + ib));
+            ib += 8;
         }
-        //将数组中的第j项变成前j项之和
-        for(int j = 1; j < 10; j++){
-            bucket[j] = bucket[j] + bucket[j - 1];
+        else{
+            break;
+        }
+    }
+    //寄存器中剩下的8个数与两个数组的剩余部分做三路融合
+    value_type rest[8];
+    _mm256_storeu_si256((__m256i*)rest, regs[0]);
+    size_t ir = 0;
+    while(ir < 8 || ia < len_a || ib < len_b){
+        int pick = -1;
+        if(ir < 8){
+            pick = 0;
         }
-        //根据bucket数组将桶中的数按顺序放入help数组
-        for(int j = len - 1; j >= 0; j--){
-            int element = int(arr[j] / (pow(10, i)));
-            int radix = element % 10;
-            help[bucket[radix] - 1] = arr[j];
-            bucket[radix]--;
+        if(ia < len_a && (pick < 0 || a[ia] < rest[ir])){
+            pick = 1;
         }
-        //将arr数组按help数组排列
-        for(int j = 0; j < len; j++){
-            arr[j] = help[j];
+        if(ib < len_b && (pick < 0 || b[ib] < (pick == 0 ? rest[ir] : a[ia]))){
+            pick = 2;
         }
+        *out++ = pick == 0 ? rest[ir++] : (pick == 1 ? a[ia++] : b[ib++]);
     }
 }
+#endif
 
-//计算最大数的位数
-int count_num_max_len(int arr[], int len){
-    int max = *max_element(arr, arr+len-1);
-    int max_len = 0;
-    while(max > 0){
-        max /= 10;
-        max_len++;
+//判断迭代器指向的是否是一段连续内存（指针或vector的迭代器）
+template<typename It>
+struct is_contiguous_iterator : integral_constant<bool, is_pointer<It>::value ||
+        is_same<It, typename vector<typename iterator_traits<It>::value_type>::iterator>::value> {};
+
+template<typename It>
+typename iterator_traits<It>::value_type* iterator_address(It it){
+    return &*it;
+}
+
+//判断某种元素类型+比较器+迭代器能否使用AVX2排序网络
+template<typename It, typename Compare, typename T, bool AllowFloat>
+struct use_simd_sort : integral_constant<bool, is_contiguous_iterator<It>::value &&
+        is_same<Compare, less<T>>::value && (is_same<T, int>::value || (AllowFloat && is_same<T, float>::value))> {};
+
+template<typename T>
+void simd_sort_small(T* data, size_t len);
+
+#if SORT_HAS_AVX2_KERNEL
+template<>
+inline void simd_sort_small<int>(int* data, size_t len){
+    simd_sort_small_avx2<Avx2Int32>(data, len);
+}
+
+template<>
+inline void simd_sort_small<float>(float* data, size_t len){
+    simd_sort_small_avx2<Avx2Float>(data, len);
+}
+#endif
+
+template<typename RandomIt, typename Compare>
+void small_sort_dispatch(RandomIt first, RandomIt last, Compare comp, false_type){
+    insertion_sort(first, last, comp);
+}
+
+template<typename RandomIt, typename Compare>
+void small_sort_dispatch(RandomIt first, RandomIt last, Compare comp, true_type){
+#if SORT_HAS_AVX2_KERNEL
+    size_t len = last - first;
+    if(len > 8 && len <= SIMD_SORT_MAX && cpu_has_avx2()){
+        simd_sort_small(iterator_address(first), len);
+        return;
+    }
+#endif
+    insertion_sort(first, last, comp);
+}
+
+//小区间排序：能用AVX2排序网络就用，否则插入排序。AllowFloat为false时保证稳定
+template<bool AllowFloat, typename RandomIt, typename Compare>
+void small_sort(RandomIt first, RandomIt last, Compare comp){
+    typedef typename iterator_traits<RandomIt>::value_type value_type;
+    small_sort_dispatch(first, last, comp, integral_constant<bool, use_simd_sort<RandomIt, Compare, value_type, AllowFloat>::value>());
+}
+
+template<typename InIt1, typename InIt2, typename OutIt, typename Compare>
+OutIt merge_dispatch(InIt1 first1, InIt1 last1, InIt2 first2, InIt2 last2, OutIt out, Compare comp, false_type){
+    return merge_run(first1, last1, first2, last2, out, comp);
+}
+
+template<typename InIt1, typename InIt2, typename OutIt, typename Compare>
+OutIt merge_dispatch(InIt1 first1, InIt1 last1, InIt2 first2, InIt2 last2, OutIt out, Compare comp, true_type){
+#if SORT_HAS_AVX2_KERNEL
+    if(last1 - first1 >= 8 && last2 - first2 >= 8 && cpu_has_avx2()){
+        simd_merge_avx2<Avx2Int32>(iterator_address(first1), last1 - first1, iterator_address(first2), last2 - first2, iterator_address(out));
+        return out + ((last1 - first1) + (last2 - first2));
+    }
+#endif
+    return merge_run(first1, last1, first2, last2, out, comp);
+}
+
+//两个有序段的融合：int32且内存连续时用SIMD融合，否则普通融合
+template<typename InIt1, typename InIt2, typename OutIt, typename Compare>
+OutIt fast_merge(InIt1 first1, InIt1 last1, InIt2 first2, InIt2 last2, OutIt out, Compare comp){
+    typedef typename iterator_traits<InIt1>::value_type value_type;
+    const bool simd = use_simd_sort<InIt1, Compare, value_type, false>::value && use_simd_sort<InIt2, Compare, value_type, false>::value
+            && use_simd_sort<OutIt, Compare, value_type, false>::value;
+    return merge_dispatch(first1, last1, first2, last2, out, comp, integral_constant<bool, simd>());
+}
+
+/*************************快速选择与部分排序*************************
+ * 求前k小、中位数、百分位数时不需要把整个数组排好序，只要找到第k小的数并把数组按它划分好
+ * 思路和quick_partion一样：三路partition之后只往包含第k个位置的那一边继续，期望O(n)
+ *      1）intro_select：pivot选择和intro_sort相同，循环次数超过2log(n)次说明pivot一直很差，改用中位数的中位数（BFPRT），保证最坏O(n)
+ *      2）partial_sort_select：先选出第k小，再只对前k个数排序
+ *      3）multi_select：一次求多个位置（比如p50/p99/p999），先选中间那个位置，再把剩下的位置分到左右两边递归，
+ *         相当于只在需要的位置上做了一部分快速排序
+ *      4）filtered_select：数组很大并且不允许修改时，先抽样估计第k小附近的一个区间[lo, hi]，
+ *         然后用AVX2一次扫描：统计小于lo的个数，同时把落在区间内的数压缩（stream compaction）到一个小数组里，
+ *         只在这个小数组上做选择，大部分数据只被读一遍；估计失败时退回复制一份再选择
+ */
+
+//中位数的中位数（BFPRT）：五个一组取中位数，再递归求这些中位数的中位数作为pivot，最坏O(n)
+template<typename RandomIt, typename Compare>
+void median_of_medians_select(RandomIt first, RandomIt nth, RandomIt last, Compare comp){
+    while(last - first > 5){
+        ptrdiff_t group_num = 0;
+        for(RandomIt group = first; group < last; group += 5){
+            RandomIt group_end = last - group < 5 ? last : group + 5;
+            insertion_sort(group, group_end, comp);
+            iter_swap(first + group_num, group + (group_end - group) / 2);//每组的中位数移到最前面
+            group_num++;
+        }
+        median_of_medians_select(first, first + group_num / 2, first + group_num, comp);
+        auto pivot = *(first + group_num / 2);
+        pair<RandomIt, RandomIt> equal = partition_three_way(first, last, pivot, comp);
+        if(nth < equal.first){
+            last = equal.first;
+        }
+        else if(nth >= equal.second){
+            first = equal.second;
+        }
+        else{
+            return;
+        }
     }
-    return max_len;
+    insertion_sort(first, last, comp);
 }
 
-int main(){
+//快速选择：结束后*nth是第nth小的数，左边都不大于它，右边都不小于它（和nth_element一样）
+template<typename RandomIt, typename Compare>
+void intro_select(RandomIt first, RandomIt nth, RandomIt last, Compare comp){
+    if(nth == last){
+        return;
+    }
+    int budget = 0;
+    for(ptrdiff_t len = last - first; len > 1; len >>= 1){
+        budget += 2;
+    }
+    while(last - first > INTRO_INSERT_CUTOFF){
+        if(budget-- == 0){//pivot一直选得不好
+            median_of_medians_select(first, nth, last, comp);
+            return;
+        }
+        choose_pivot(first, last, comp);
+        auto pivot = *first;
+        pair<RandomIt, RandomIt> equal = partition_three_way(first, last, pivot, comp);
+        if(nth < equal.first){
+            last = equal.first;
+        }
+        else if(nth >= equal.second){
+            first = equal.second;
+        }
+        else{
+            return;//第nth个位置落在等于pivot的区域
+        }
+    }
+    small_sort<true>(first, last, comp);
+}
+
+template<typename RandomIt>
+void intro_select(RandomIt first, RandomIt nth, RandomIt last){
+    intro_select(first, nth, last, less<typename iterator_traits<RandomIt>::value_type>());
+}
+
+//部分排序：[first, middle)是最小的那些数并且有序，其余的数顺序不定
+template<typename RandomIt, typename Compare>
+void partial_sort_select(RandomIt first, RandomIt middle, RandomIt last, Compare comp){
+    if(middle == first){
+        return;
+    }
+    intro_select(first, middle - 1, last, comp);
+    intro_sort(first, middle - 1, comp);
+}
+
+template<typename RandomIt, typename Compare>
+void multi_select_process(RandomIt first, RandomIt last, ptrdiff_t offset, const size_t* rank_begin, const size_t* rank_end, Compare comp){
+    while(rank_begin != rank_end){
+        const size_t* mid = rank_begin + (rank_end - rank_begin) / 2;
+        RandomIt nth = first + ((ptrdiff_t)*mid - offset);
+        intro_select(first, nth, last, comp);
+        //左边的位置在[first, nth)中递归，右边的位置在(nth, last)中继续循环
+        multi_select_process(first, nth, offset, rank_begin, mid, comp);
+        offset += (nth + 1) - first;
+        first = nth + 1;
+        rank_begin = mid + 1;
+    }
+}
+
+//一次选出多个位置，ranks为从小到大的下标，结束后每个ranks[i]位置上都是第ranks[i]小的数
+template<typename RandomIt, typename Compare>
+void multi_select(RandomIt first, RandomIt last, vector<size_t> ranks, Compare comp){
+    sort(ranks.begin(), ranks.end());
+    ranks.erase(unique(ranks.begin(), ranks.end()), ranks.end());
+    while(!ranks.empty() && ranks.back() >= (size_t)(last - first)){
+        ranks.pop_back();
+    }
+    multi_select_process(first, last, 0, ranks.data(), ranks.data() + ranks.size(), comp);
+}
+
+//分位数，q在[0, 1]之间，取第floor(q*(n-1))小的数，会打乱数组的顺序
+template<typename RandomIt>
+vector<typename iterator_traits<RandomIt>::value_type> quantiles(RandomIt first, RandomIt last, const vector<double>& qs){
+    typedef typename iterator_traits<RandomIt>::value_type value_type;
+    vector<value_type> result;
+    size_t len = last - first;
+    if(len == 0){
+        return result;
+    }
+    vector<size_t> ranks;
+    for(double q : qs){
+        ranks.push_back((size_t)(min(max(q, 0.0), 1.0) * (len - 1)));
+    }
+    multi_select(first, last, ranks, less<value_type>());
+    for(size_t rank : ranks){
+        result.push_back(*(first + rank));
+    }
+    return result;
+}
+
+//单次扫描：统计小于lo的个数，把[lo, hi]中的数写入window，window放不下时返回false
+template<typename T>
+bool filter_window_scalar(const T* data, size_t len, T lo, T hi, size_t& less_count, vector<T>& window){
+    size_t count = 0;
+    size_t pos = 0;
+    size_t capacity = window.size();
+    for(size_t i = 0; i < len; i++){
+        T value = data[i];
+        count += value < lo;
+        if(!(value < lo) && !(hi < value)){
+            if(pos == capacity){
+                return false;
+            }
+            window[pos++] = value;
+        }
+    }
+    less_count = count;
+    window.resize(pos);
+    return true;
+}
+
+#if SORT_HAS_AVX2_KERNEL
+//stream compaction用的置换表：mask中为1的通道依次排到前面
+struct CompressTable{
+    alignas(32) int index[256][8];
+    CompressTable(){
+        for(int mask = 0; mask < 256; mask++){
+            int pos = 0;
+            for(int lane = 0; lane < 8; lane++){
+                if(mask & (1 << lane)){
+                    index[mask][pos++] = lane;
+                }
+            }
+            while(pos < 8){
+                index[mask][pos++] = 0;
+            }
+        }
+    }
+};
+
+inline const CompressTable& compress_table(){
+    static const CompressTable table;
+    return table;
+}
+
+//得到8个通道中小于lo和落在[lo, hi]中的掩码
+__attribute__((target("avx2"))) inline void filter_masks(__m256i v, __m256i lo, __m256i hi, int& less_mask, int& in_mask, int){
+    __m256i below = _mm256_cmpgt_epi32(lo, v);
+    __m256i above = _mm256_cmpgt_epi32(v, hi);
+    less_mask = _mm256_movemask_ps(_mm256_castsi256_ps(below));
+    in_mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(below, above))) & 0xFF;
+}
+
+__attribute__((target("avx2"))) inline void filter_masks(__m256i v, __m256i lo, __m256i hi, int& less_mask, int& in_mask, float){
+    __m256 value = _mm256_castsi256_ps(v);
+    less_mask = _mm256_movemask_ps(_mm256_cmp_ps(value, _mm256_castsi256_ps(lo), _CMP_LT_OQ));
+    in_mask = _mm256_movemask_ps(_mm256_and_ps(_mm256_cmp_ps(value, _mm256_castsi256_ps(lo), _CMP_GE_OQ),
+            _mm256_cmp_ps(value, _mm256_castsi256_ps(hi), _CMP_LE_OQ)));
+}
+
+template<typename T>
+__attribute__((target("avx2"))) bool filter_window_avx2(const T* data, size_t len, T lo, T hi, size_t& less_count, vector<T>& window){
+    const CompressTable& table = compress_table();
+    __m256i lo_v, hi_v;
+    {
+        T lo_lanes[8], hi_lanes[8];
+        fill(lo_lanes, lo_lanes + 8, lo);
+        fill(hi_lanes, hi_lanes + 8, hi);
+        lo_v = _mm256_loadu_si256((const __m256i*)lo_lanes);
+        hi_v = _mm256_loadu_si256((const __m256i*)hi_lanes);
+    }
+    size_t count = 0;
+    size_t pos = 0;
+    size_t capacity = window.size();
+    size_t i = 0;
+    for(; i + 8 <= len; i += 8){
+        __m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+        int less_mask, in_mask;
+        filter_masks(v, lo_v, hi_v, less_mask, in_mask, T());
+        count += __builtin_popcount(less_mask);
+        if(in_mask != 0){
+            if(pos + 8 > capacity){//整块写入需要8个空位
+                return false;
+            }
+            __m256i packed = _mm256_permutevar8x32_epi32(v, _mm256_load_si256((const __m256i*)table.index[in_mask]));
+            _mm256_storeu_si256((__m256i*)(window.data() + pos), packed);
+            pos += __builtin_popcount(in_mask);
+        }
+    }
+    for(; i < len; i++){
+        T value = data[i];
+        count += value < lo;
+        if(!(value < lo) && !(hi < value)){
+            if(pos == capacity){
+                return false;
+            }
+            window[pos++] = value;
+        }
+    }
+    less_count = count;
+    window.resize(pos);
+    return true;
+}
+#endif
+
+//int32和float在支持AVX2时使用SIMD扫描，其余类型使用标量扫描
+template<typename T>
+bool filter_window(const T* data, size_t len, T lo, T hi, size_t& less_count, vector<T>& window){
+    return filter_window_scalar(data, len, lo, hi, less_count, window);
+}
+
+#if SORT_HAS_AVX2_KERNEL
+inline bool filter_window(const int* data, size_t len, int lo, int hi, size_t& less_count, vector<int>& window){
+    return cpu_has_avx2() ? filter_window_avx2(data, len, lo, hi, less_count, window) : filter_window_scalar(data, len, lo, hi, less_count, window);
+}
+
+inline bool filter_window(const float* data, size_t len, float lo, float hi, size_t& less_count, vector<float>& window){
+    return cpu_has_avx2() ? filter_window_avx2(data, len, lo, hi, less_count, window) : filter_window_scalar(data, len, lo, hi, less_count, window);
+}
+#endif
+
+//不修改原数组求第k小（下标从0开始），先抽样确定一个很可能包含答案的区间，一次扫描把区间内的数过滤出来
+//k >= len时抛出out_of_range
+template<typename T>
+T filtered_select(const T* data, size_t len, size_t k){
+    if(k >= len){
+        throw out_of_range("filtered_select: k must be less than len");
+    }
+    const size_t small_len = 1 << 16;
+    if(len <= small_len){
+        vector<T> copy(data, data + len);
+        intro_select(copy.begin(), copy.begin() + k, copy.end());
+        return copy[k];
+    }
+    //抽样大小约为n^(2/3)，样本排好序后按比例取k附近的上下界
+    size_t sample_len = min<size_t>(len / 4, (size_t)pow((double)len, 2.0 / 3.0));
+    vector<T> sample(sample_len);
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for(size_t i = 0; i < sample_len; i++){
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        sample[i] = data[state % len];
+    }
+    intro_sort(sample.begin(), sample.end());
+    double position = (double)k * sample_len / len;
+    double delta = 3.0 * sqrt((double)sample_len);
+    size_t lo_rank = (size_t)max(0.0, position - delta);
+    size_t hi_rank = (size_t)min((double)sample_len - 1, position + delta);
+    T lo = sample[lo_rank];
+    T hi = sample[hi_rank];
+
+    size_t expected = (size_t)((double)(hi_rank - lo_rank + 1) * len / sample_len);
+    vector<T> window(2 * expected + 1024);
+    size_t less_count = 0;
+    bool filtered = filter_window(data, len, lo, hi, less_count, window);
+    if(filtered && less_count <= k && k < less_count + window.size()){
+        intro_select(window.begin(), window.begin() + (k - less_count), window.end());
+        return window[k - less_count];
+    }
+    //估计的区间没有包含答案，复制一份直接选择
+    vector<T> copy(data, data + len);
+    intro_select(copy.begin(), copy.begin() + k, copy.end());
+    return copy[k];
+}
+
+/*************************d叉堆*************************
+ * 上面的heap_sort用heap_insert逐个向上调整建堆，是O(nlogn)的，并且是二叉堆，每向下一层就是一次很可能不命中缓存的访问
+ * d叉堆（d=4/8）的改进：
+ *      1）树高变为log_d(n)，一个节点的d个孩子在内存中连续存放，DaryHeap中还让每组孩子从缓存行的边界开始，一次缓存访问就能比较完所有孩子
+ *      2）建堆用Floyd方法：从最后一个非叶子节点开始向下调整，总代价O(n)
+ *      3）弹出堆顶时用自底向上（Wegener）的向下调整：先不和被调整的数比较，沿着最大的孩子一路走到叶子，再从叶子向上找位置，
+ *         被调整的数（原来的最后一个数）通常很小，向上走不了几步，所以每层省掉了一次比较
+ */
+const int HEAP_DEFAULT_ARITY = 4;
+const size_t CACHE_LINE_SIZE = 64;
+
+//按缓存行对齐分配内存的分配器
+template<typename T, size_t Align = CACHE_LINE_SIZE>
+struct AlignedAllocator{
+    typedef T value_type;
+    template<typename U>
+    struct rebind{
+        typedef AlignedAllocator<U, Align> other;
+    };
+    AlignedAllocator() {}
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Align>&) {}
+
+    //多申请一些空间，对齐后的地址前面保存原始地址
+    T* allocate(size_t n){
+        void* raw = ::operator new(n * sizeof(T) + Align + sizeof(void*));
+        uintptr_t aligned = ((uintptr_t)raw + sizeof(void*) + Align - 1) & ~(uintptr_t)(Align - 1);
+        ((void**)aligned)[-1] = raw;
+        return (T*)aligned;
+    }
+    void deallocate(T* p, size_t){
+        ::operator delete(((void**)p)[-1]);
+    }
+};
+
+template<typename T, typename U, size_t Align>
+bool operator==(const AlignedAllocator<T, Align>&, const AlignedAllocator<U, Align>&){ return true; }
+template<typename T, typename U, size_t Align>
+bool operator!=(const AlignedAllocator<T, Align>&, const AlignedAllocator<U, Align>&){ return false; }
+
+//[child, child+D)与堆大小的交集中最大的孩子
+template<int D, typename RandomIt, typename Compare>
+ptrdiff_t dary_largest_child(RandomIt first, ptrdiff_t child, ptrdiff_t heap_size, Compare comp){
+    ptrdiff_t last = min<ptrdiff_t>(child + D, heap_size);
+    ptrdiff_t largest = child;
+    for(ptrdiff_t i = child + 1; i < last; i++){
+        if(comp(*(first + largest), *(first + i))){
+            largest = i;
+        }
+    }
+    return largest;
+}
+
+//把value放到hole的位置并向上调整，top之上不再调整
+template<int D, typename RandomIt, typename T, typename Compare>
+void dary_sift_up(RandomIt first, ptrdiff_t hole, ptrdiff_t top, T&& value, Compare comp){
+    while(hole > top){
+        ptrdiff_t parent = (hole - 1) / D;
+        if(!comp(*(first + parent), value)){
+            break;
+        }
+        *(first + hole) = std::move(*(first + parent));
+        hole = parent;
+    }
+    *(first + hole) = std::move(value);
+}
+
+//普通的向下调整，建堆时使用
+template<int D, typename RandomIt, typename Compare>
+void dary_sift_down(RandomIt first, ptrdiff_t hole, ptrdiff_t heap_size, Compare comp){
+    auto value = std::move(*(first + hole));
+    ptrdiff_t child = hole * D + 1;
+    while(child < heap_size){
+        ptrdiff_t largest = dary_largest_child<D>(first, child, heap_size, comp);
+        if(!comp(value, *(first + largest))){
+            break;
+        }
+        *(first + hole) = std::move(*(first + largest));
+        hole = largest;
+        child = hole * D + 1;
+    }
+    *(first + hole) = std::move(value);
+}
+
+//自底向上的向下调整：hole一路沿最大的孩子下沉到叶子，再把value从叶子向上调整
+template<int D, typename RandomIt, typename T, typename Compare>
+void dary_sift_down_bottom_up(RandomIt first, ptrdiff_t hole, ptrdiff_t heap_size, T&& value, Compare comp){
+    ptrdiff_t top = hole;
+    ptrdiff_t child = hole * D + 1;
+    while(child < heap_size){
+        ptrdiff_t largest = dary_largest_child<D>(first, child, heap_size, comp);
+        *(first + hole) = std::move(*(first + largest));
+        hole = largest;
+        child = hole * D + 1;
+    }
+    dary_sift_up<D>(first, hole, top, std::move(value), comp);
+}
+
+//Floyd建堆，O(n)
+template<int D, typename RandomIt, typename Compare>
+void dary_make_heap(RandomIt first, RandomIt last, Compare comp){
+    ptrdiff_t len = last - first;
+    for(ptrdiff_t i = (len - 2) / D; i >= 0 && len > 1; i--){
+        dary_sift_down<D>(first, i, len, comp);
+    }
+}
+
+//d叉堆排序：建堆后依次把堆顶放到末尾，末尾原来的数从根开始自底向上调整
+template<int D, typename RandomIt, typename Compare>
+void dary_heap_sort(RandomIt first, RandomIt last, Compare comp){
+    ptrdiff_t len = last - first;
+    dary_make_heap<D>(first, last, comp);
+    for(ptrdiff_t heap_size = len - 1; heap_size > 0; heap_size--){
+        auto value = std::move(*(first + heap_size));
+        *(first + heap_size) = std::move(*first);
+        dary_sift_down_bottom_up<D>(first, 0, heap_size, std::move(value), comp);
+    }
+}
+
+//通用堆排序，默认使用4叉堆
+template<typename RandomIt, typename Compare>
+void heap_sort(RandomIt first, RandomIt last, Compare comp){
+    dary_heap_sort<HEAP_DEFAULT_ARITY>(first, last, comp);
+}
+
+/**
+ * d叉堆实现的优先队列，用法和priority_queue一样，默认是大根堆
+ * 存储时在最前面空出D-1个位置，这样下标为i的节点的孩子在存储中的位置是D*(i+1)...D*(i+1)+D-1，
+ * 每组孩子都从D个元素的边界开始，存储本身按缓存行对齐，D*sizeof(T)等于缓存行大小时一组孩子正好占一个缓存行
+ */
+template<typename T, int D = HEAP_DEFAULT_ARITY, typename Compare = less<T>>
+class DaryHeap{
+private:
+    vector<T, AlignedAllocator<T>> storage;
+    Compare comp;
+
+    typename vector<T, AlignedAllocator<T>>::iterator base(){
+        return storage.begin() + (D - 1);
+    }
+
+public:
+    explicit DaryHeap(const Compare& c = Compare()) : storage(D - 1), comp(c) {}
+
+    //用一组数据直接建堆，O(n)
+    template<typename InputIt>
+    DaryHeap(InputIt first, InputIt last, const Compare& c = Compare()) : storage(D - 1), comp(c) {
+        storage.insert(storage.end(), first, last);
+        dary_make_heap<D>(base(), storage.end(), comp);
+    }
+
+    bool empty() const { return storage.size() == (size_t)(D - 1); }
+    size_t size() const { return storage.size() - (D - 1); }
+    const T& top() const { return storage[D - 1]; }
+
+    void push(T value){
+        storage.push_back(value);
+        dary_sift_up<D>(base(), (ptrdiff_t)size() - 1, 0, std::move(value), comp);
+    }
+
+    void pop(){
+        T value = std::move(storage.back());
+        storage.pop_back();
+        if(!empty()){
+            dary_sift_down_bottom_up<D>(base(), 0, (ptrdiff_t)size(), std::move(value), comp);
+        }
+    }
+};
+
+//比较二叉/4叉/8叉堆排序和std::make_heap+std::sort_heap
+void benchmark_heap_sort(size_t len){
+    vector<int> origin(len);
+    for(size_t i = 0; i < len; i++){
+        origin[i] = rand() ^ (rand() << 15);
+    }
+    const char* names[] = {"binary heap_sort", "4-ary heap_sort", "8-ary heap_sort", "std::make_heap+sort_heap"};
+    for(int k = 0; k < 4; k++){
+        vector<int> data = origin;
+        auto start = chrono::steady_clock::now();
+        if(k == 0){
+            dary_heap_sort<2>(data.begin(), data.end(), less<int>());
+        }
+        else if(k == 1){
+            dary_heap_sort<4>(data.begin(), data.end(), less<int>());
+        }
+        else if(k == 2){
+            dary_heap_sort<8>(data.begin(), data.end(), less<int>());
+        }
+        else{
+            make_heap(data.begin(), data.end());
+            sort_heap(data.begin(), data.end());
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout<<names[k]<<": "<<seconds * 1e9 / max<size_t>(len, 1)<<" ns/element"<<(is_sorted(data.begin(), data.end()) ? "" : " (wrong)")<<endl;
+    }
+}
+
+/*************************基数排序*************************
+ * 原来的桶排序按十进制位分桶，每一位都要用pow(10, i)做浮点运算，并且只能处理非负整数
+ * 这里改成按二进制位分桶的LSD基数排序：
+ *      1）32位的键每次取11位（3趟），64位的键每次取8位（8趟），位运算取digit
+ *      2）遍历一次数组就把所有趟的词频统计出来，不用每一趟都统计一次
+ *      3）如果某一趟所有数在该位上都相同（某个桶的词频等于n），这一趟直接跳过
+ *      4）有符号整数把符号位取反、浮点数负数全部取反正数只取反符号位，就可以当作无符号数比较大小
+ *      5）原数组和辅助数组来回分配（ping-pong），最后结果如果在辅助数组里再拷贝回来
+ * 可以只排键，也可以通过key_of从结构体中取键（整条记录跟着移动），或者键和payload分别存放在两个数组中
+ */
+const size_t RADIX_SMALL_CUTOFF = 64;//小于该长度时直接插入排序
+
+//把各种类型的键映射为无符号整数，映射后无符号的大小关系与原来的大小关系一致
+template<typename T>
+typename enable_if<is_integral<T>::value && is_unsigned<T>::value, T>::type radix_key(T value){
+    return value;
+}
+
+template<typename T>
+typename enable_if<is_integral<T>::value && is_signed<T>::value, typename make_unsigned<T>::type>::type radix_key(T value){
+    typedef typename make_unsigned<T>::type unsigned_type;
+    return (unsigned_type)value ^ ((unsigned_type)1 << (sizeof(T) * 8 - 1));//符号位取反
+}
+
+inline uint32_t radix_key(float value){
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 31) ? ~bits : (bits | 0x80000000u);
+}
+
+inline uint64_t radix_key(double value){
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 63) ? ~bits : (bits | 0x8000000000000000ull);
+}
+
+//默认取键的方式：元素本身就是键
+struct RadixIdentity{
+    template<typename T>
+    auto operator()(const T& value) const -> decltype(radix_key(value)) {
+        return radix_key(value);
+    }
+};
+
+//每一趟取的位数：32位及以下的键11位，64位的键8位
+template<typename Key>
+int radix_digit_bits(){
+    return sizeof(Key) <= 4 ? 11 : 8;
+}
+
+//把某一趟的词频变成前缀和（每个桶的起始位置），如果所有数都落在同一个桶里就返回false
+inline bool radix_prefix_sum(size_t* count, size_t bucket_num, size_t len){
+    size_t sum = 0;
+    for(size_t i = 0; i < bucket_num; i++){
+        if(count[i] == len){
+            return false;
+        }
+        size_t c = count[i];
+        count[i] = sum;
+        sum += c;
+    }
+    return true;
+}
+
+//通用基数排序（稳定），key_of返回无符号整数作为排序的键
+template<typename T, typename KeyOf>
+void radix_sort(T* first, T* last, KeyOf key_of){
+    typedef typename decay<decltype(key_of(*first))>::type key_type;
+    size_t len = last - first;
+    if(len <= RADIX_SMALL_CUTOFF){
+        insertion_sort(first, last, [&key_of](const T& a, const T& b){ return key_of(a) < key_of(b); });
+        return;
+    }
+    const int digit_bits = radix_digit_bits<key_type>();
+    const int pass_num = ((int)sizeof(key_type) * 8 + digit_bits - 1) / digit_bits;
+    const size_t bucket_num = (size_t)1 << digit_bits;
+    const key_type mask = (key_type)(bucket_num - 1);
+
+    vector<size_t> histogram(bucket_num * pass_num, 0);
+    for(size_t i = 0; i < len; i++){//一次遍历统计所有趟的词频
+        key_type key = key_of(first[i]);
+        for(int pass = 0; pass < pass_num; pass++){
+            histogram[pass * bucket_num + ((key >> (pass * digit_bits)) & mask)]++;
+        }
+    }
+
+    vector<T> buffer(len);
+    T* src = first;
+    T* dst = buffer.data();
+    for(int pass = 0; pass < pass_num; pass++){
+        size_t* offset = &histogram[pass * bucket_num];
+        if(!radix_prefix_sum(offset, bucket_num, len)){//这一位全部相同，跳过
+            continue;
+        }
+        int shift = pass * digit_bits;
+        for(size_t i = 0; i < len; i++){
+            size_t digit = (key_of(src[i]) >> shift) & mask;
+            dst[offset[digit]++] = std::move(src[i]);
+        }
+        swap(src, dst);
+    }
+    if(src != first){
+        std::move(src, src + len, first);
+    }
+}
+
+//对整数、浮点数直接排序
+template<typename T>
+void radix_sort(T* first, T* last){
+    radix_sort(first, last, RadixIdentity());
+}
+
+//键与payload分别存放在两个数组中，按键排序的同时移动payload
+template<typename K, typename V>
+void radix_sort_pairs(K* keys, V* values, size_t len){
+    typedef decltype(radix_key(*keys)) key_type;
+    if(len <= 1){
+        return;
+    }
+    const int digit_bits = radix_digit_bits<key_type>();
+    const int pass_num = ((int)sizeof(key_type) * 8 + digit_bits - 1) / digit_bits;
+    const size_t bucket_num = (size_t)1 << digit_bits;
+    const key_type mask = (key_type)(bucket_num - 1);
+
+    vector<size_t> histogram(bucket_num * pass_num, 0);
+    for(size_t i = 0; i < len; i++){
+        key_type key = radix_key(keys[i]);
+        for(int pass = 0; pass < pass_num; pass++){
+            histogram[pass * bucket_num + ((key >> (pass * digit_bits)) & mask)]++;
+        }
+    }
+
+    vector<K> key_buffer(len);
+    vector<V> value_buffer(len);
+    K* key_src = keys;
+    K* key_dst = key_buffer.data();
+    V* value_src = values;
+    V* value_dst = value_buffer.data();
+    for(int pass = 0; pass < pass_num; pass++){
+        size_t* offset = &histogram[pass * bucket_num];
+        if(!radix_prefix_sum(offset, bucket_num, len)){
+            continue;
+        }
+        int shift = pass * digit_bits;
+        for(size_t i = 0; i < len; i++){
+            size_t position = offset[(radix_key(key_src[i]) >> shift) & mask]++;
+            key_dst[position] = key_src[i];
+            value_dst[position] = std::move(value_src[i]);
+        }
+        swap(key_src, key_dst);
+        swap(value_src, value_dst);
+    }
+    if(key_src != keys){
+        std::copy(key_src, key_src + len, keys);
+        std::move(value_src, value_src + len, values);
+    }
+}
+
+//桶排序：原来的十进制版本只能排非负整数，现在直接用基数排序
+void bucket_sort(int arr[], int len){
+    if(len <= 1){
+        return;
+    }
+    radix_sort(arr, arr + len);
+}
+
+/*************************计数排序*************************
+ * 原来的计数排序写死了bucket[10]，只能排0~9，遇到负数或者大于9的数会越界
+ * 通用的计数排序：
+ *      1）先扫一遍求出键的最小值和最大值，键映射为无符号数（同基数排序的radix_key）后减去最小值就是桶号
+ *      2）值域 max-min+1 不超过 max(n, COUNTING_SMALL_RANGE) 且不超过 COUNTING_MAX_RANGE 时用稠密的词频表，
+ *         否则词频表太稀疏、放不进缓存，自动退化为基数排序
+ *      3）长数组切成若干段，每段各自统计局部词频（不用原子操作），
+ *         前缀和时桶b中按段号依次排列，每段从自己的起点开始分配，所以分配也可以并行，并且是稳定的
+ *      4）只排键的时候不需要分配，直接按词频把值写回去；带payload时整条记录（或者键和payload两个数组）稳定地分配到辅助数组
+ */
+const size_t COUNTING_SMALL_RANGE = 1 << 16;//值域不超过该大小时总是用词频表（词频表放得进L2）
+const size_t COUNTING_MAX_RANGE = 1 << 22;//值域超过该大小时词频表太大，改用基数排序
+const size_t COUNTING_PARALLEL_MIN = 1 << 16;//小于该长度不切段并行
+
+//统计每段的词频，成功时counts[chunk * range + b]为第chunk段中桶b的个数；值域太大返回false
+template<typename T, typename KeyOf, typename Key>
+bool counting_histogram(const T* data, size_t len, KeyOf key_of, vector<size_t>& counts,
+                        size_t& range, size_t& chunk_num, size_t& chunk_len, Key& min_key, ThreadPool& pool){
+    chunk_num = len >= COUNTING_PARALLEL_MIN ? (size_t)pool.concurrency() : 1;
+    chunk_len = (len + chunk_num - 1) / chunk_num;
+
+    //1）每段求最小值、最大值
+    vector<Key> chunk_min(chunk_num, numeric_limits<Key>::max());
+    vector<Key> chunk_max(chunk_num, numeric_limits<Key>::min());
+    parallel_for(0, chunk_num, 1, [&](size_t chunk_lo, size_t chunk_hi){
+        for(size_t chunk = chunk_lo; chunk < chunk_hi; chunk++){
+            size_t end = min((chunk + 1) * chunk_len, len);
+            Key lo = numeric_limits<Key>::max();
+            Key hi = numeric_limits<Key>::min();
+            for(size_t i = chunk * chunk_len; i < end; i++){
+                Key key = key_of(data[i]);
+                lo = min(lo, key);
+                hi = max(hi, key);
+            }
+            chunk_min[chunk] = lo;
+            chunk_max[chunk] = hi;
+        }
+    }, pool);
+    min_key = *min_element(chunk_min.begin(), chunk_min.end());
+    Key span = *max_element(chunk_max.begin(), chunk_max.end()) - min_key;//值域减一，避免64位键全范围时溢出
+    if((uint64_t)span >= max<size_t>(COUNTING_SMALL_RANGE, len) || (uint64_t)span >= COUNTING_MAX_RANGE){
+        return false;
+    }
+    range = (size_t)span + 1;
+
+    //2）每段一张局部词频表，段数太多时词频表的总大小会超过数组本身，这时减少段数
+    if(chunk_num > 1 && chunk_num * range > len){
+        chunk_num = max<size_t>(len / range, 1);
+        chunk_len = (len + chunk_num - 1) / chunk_num;
+    }
+    counts.assign(chunk_num * range, 0);
+    parallel_for(0, chunk_num, 1, [&](size_t chunk_lo, size_t chunk_hi){
+        for(size_t chunk = chunk_lo; chunk < chunk_hi; chunk++){
+            size_t end = min((chunk + 1) * chunk_len, len);
+            size_t* count = &counts[chunk * range];
+            for(size_t i = chunk * chunk_len; i < end; i++){
+                count[(size_t)(key_of(data[i]) - min_key)]++;
+            }
+        }
+    }, pool);
+    return true;
+}
+
+//把每段的词频变成每段在每个桶中的写入起点：桶b中按段号依次排列
+inline void counting_offsets(size_t* counts, size_t range, size_t chunk_num){
+    size_t sum = 0;
+    for(size_t b = 0; b < range; b++){
+        for(size_t chunk = 0; chunk < chunk_num; chunk++){
+            size_t c = counts[chunk * range + b];
+            counts[chunk * range + b] = sum;
+            sum += c;
+        }
+    }
+}
+
+//把radix_key映射后的无符号键还原为整数
+template<typename T>
+T counting_value(decltype(radix_key(T())) key){
+    return (T)(key ^ radix_key(T()));//有符号数radix_key(0)恰好是符号位
+}
+
+//通用计数排序（稳定），key_of返回整数键，整条记录跟着移动
+template<typename T, typename KeyOf>
+void counting_sort(T* first, T* last, KeyOf key_of, ThreadPool& pool){
+    size_t len = last - first;
+    auto unsigned_key = [&key_of](const T& value){ return radix_key(key_of(value)); };
+    typedef typename decay<decltype(unsigned_key(*first))>::type key_type;
+    if(len <= RADIX_SMALL_CUTOFF){
+        insertion_sort(first, last, [&unsigned_key](const T& a, const T& b){ return unsigned_key(a) < unsigned_key(b); });
+        return;
+    }
+    vector<size_t> counts;
+    size_t range, chunk_num, chunk_len;
+    key_type min_key;
+    if(!counting_histogram(first, len, unsigned_key, counts, range, chunk_num, chunk_len, min_key, pool)){
+        radix_sort(first, last, unsigned_key);
+        return;
+    }
+    counting_offsets(counts.data(), range, chunk_num);
+
+    vector<T> buffer(len);
+    parallel_for(0, chunk_num, 1, [&](size_t chunk_lo, size_t chunk_hi){
+        for(size_t chunk = chunk_lo; chunk < chunk_hi; chunk++){
+            size_t end = min((chunk + 1) * chunk_len, len);
+            size_t* offset = &counts[chunk * range];
+            for(size_t i = chunk * chunk_len; i < end; i++){
+                buffer[offset[(size_t)(unsigned_key(first[i]) - min_key)]++] = std::move(first[i]);
+            }
+        }
+    }, pool);
+    parallel_for(0, len, PARALLEL_SORT_GRAIN, [&](size_t lo, size_t hi){
+        std::move(buffer.begin() + lo, buffer.begin() + hi, first + lo);
+    }, pool);
+}
+
+template<typename T, typename KeyOf>
+void counting_sort(T* first, T* last, KeyOf key_of){
+    counting_sort(first, last, key_of, ThreadPool::instance());
+}
+
+//只排整数：不需要分配，按词频直接把值写回去
+template<typename T>
+void counting_sort(T* first, T* last){
+    static_assert(is_integral<T>::value, "counting_sort without key_of needs integer elements");
+    typedef decltype(radix_key(T())) key_type;
+    size_t len = last - first;
+    if(len <= RADIX_SMALL_CUTOFF){
+        insertion_sort(first, last, less<T>());
+        return;
+    }
+    ThreadPool& pool = ThreadPool::instance();
+    vector<size_t> counts;
+    size_t range, chunk_num, chunk_len;
+    key_type min_key;
+    if(!counting_histogram(first, len, RadixIdentity(), counts, range, chunk_num, chunk_len, min_key, pool)){
+        radix_sort(first, last);
+        return;
+    }
+    //合并各段的词频，再算出每个值的起点，按值并行写回
+    vector<size_t> begin(range + 1, 0);
+    for(size_t b = 0; b < range; b++){
+        size_t c = 0;
+        for(size_t chunk = 0; chunk < chunk_num; chunk++){
+            c += counts[chunk * range + b];
+        }
+        begin[b + 1] = begin[b] + c;
+    }
+    parallel_for(0, range, max<size_t>(range / (pool.concurrency() * 4), 1), [&](size_t lo, size_t hi){
+        for(size_t b = lo; b < hi; b++){
+            std::fill(first + begin[b], first + begin[b + 1], counting_value<T>((key_type)(min_key + b)));
+        }
+    }, pool);
+}
+
+//键与payload分别存放在两个数组中，按键稳定排序的同时移动payload
+template<typename K, typename V>
+void counting_sort_pairs(K* keys, V* values, size_t len){
+    typedef decltype(radix_key(*keys)) key_type;
+    if(len <= 1){
+        return;
+    }
+    ThreadPool& pool = ThreadPool::instance();
+    vector<size_t> counts;
+    size_t range, chunk_num, chunk_len;
+    key_type min_key;
+    if(!counting_histogram(keys, len, RadixIdentity(), counts, range, chunk_num, chunk_len, min_key, pool)){
+        radix_sort_pairs(keys, values, len);
+        return;
+    }
+    counting_offsets(counts.data(), range, chunk_num);
+
+    vector<K> key_buffer(len);
+    vector<V> value_buffer(len);
+    parallel_for(0, chunk_num, 1, [&](size_t chunk_lo, size_t chunk_hi){
+        for(size_t chunk = chunk_lo; chunk < chunk_hi; chunk++){
+            size_t end = min((chunk + 1) * chunk_len, len);
+            size_t* offset = &counts[chunk * range];
+            for(size_t i = chunk * chunk_len; i < end; i++){
+                size_t position = offset[(size_t)(radix_key(keys[i]) - min_key)]++;
+                key_buffer[position] = keys[i];
+                value_buffer[position] = std::move(values[i]);
+            }
+        }
+    }, pool);
+    parallel_for(0, len, PARALLEL_SORT_GRAIN, [&](size_t lo, size_t hi){
+        std::copy(key_buffer.begin() + lo, key_buffer.begin() + hi, keys + lo);
+        std::move(value_buffer.begin() + lo, value_buffer.begin() + hi, values + lo);
+    }, pool);
+}
+
+//计数排序：不再限定0~9，值域较大时自动改用基数排序
+void count_sort(int arr[], int len){
+    if(len <= 1){
+        return;
+    }
+    counting_sort(arr, arr + len);
+}
+
+/*************************argsort与列存储（SoA）排序*************************
+ * 记录比较宽的时候（比如greedy_algorithm.cpp中的Project），用sort加lambda排序每次交换都要搬动整个对象
+ * argsort只对紧凑的（键，下标）排序，得到排列perm（排好序后第i个位置应当放原来的第perm[i]个元素）：
+ *      1）键能映射为32位无符号数并且长度小于2^32时，把键和下标打包成一个64位的字：高32位是键，低32位是下标，
+ *         只按高32位做基数排序（3趟），基数排序是稳定的，相同键的下标保持原来的顺序
+ *      2）否则对（键，下标）的结构体按键做基数排序；给了比较函数时对下标数组做稳定的归并排序
+ * apply_permutation按perm原地重排任意多个列数组：沿着置换的环依次移动，每个环只需要一个临时变量，
+ * 用一个位图标记已经放好的位置，不需要把整列再拷贝一份
+ * soa_sort按键列排序，并把其余各列一起重排
+ */
+//键和下标打包在一起的64位字，只按高32位排序
+struct PackedKeyIndex{
+    uint32_t operator()(uint64_t word) const {
+        return (uint32_t)(word >> 32);
+    }
+};
+
+template<typename Key>
+struct KeyIndex{
+    Key key;
+    size_t index;
+};
+
+template<typename K>
+vector<size_t> argsort(const K* keys, size_t len){
+    typedef decltype(radix_key(*keys)) key_type;
+    vector<size_t> perm(len);
+    if(sizeof(key_type) <= 4 && len <= numeric_limits<uint32_t>::max()){
+        vector<uint64_t> words(len);
+        for(size_t i = 0; i < len; i++){
+            words[i] = ((uint64_t)radix_key(keys[i]) << 32) | i;
+        }
+        radix_sort(words.data(), words.data() + len, PackedKeyIndex());
+        for(size_t i = 0; i < len; i++){
+            perm[i] = (size_t)(uint32_t)words[i];
+        }
+    }
+    else{
+        vector<KeyIndex<key_type>> entries(len);
+        for(size_t i = 0; i < len; i++){
+            entries[i].key = radix_key(keys[i]);
+            entries[i].index = i;
+        }
+        radix_sort(entries.data(), entries.data() + len, [](const KeyIndex<key_type>& e){ return e.key; });
+        for(size_t i = 0; i < len; i++){
+            perm[i] = entries[i].index;
+        }
+    }
+    return perm;
+}
+
+//按比较函数求排列（稳定）
+template<typename T, typename Compare>
+vector<size_t> argsort(const T* data, size_t len, Compare comp){
+    vector<size_t> perm(len);
+    for(size_t i = 0; i < len; i++){
+        perm[i] = i;
+    }
+    merge_sort(perm.begin(), perm.end(), [data, &comp](size_t a, size_t b){ return comp(data[a], data[b]); });
+    return perm;
+}
+
+//沿着从start出发的环重排一列：column[i] = 原来的column[perm[i]]
+template<typename T>
+void permutation_cycle(const vector<size_t>& perm, size_t start, T* column){
+    T temp = std::move(column[start]);
+    size_t i = start;
+    while(perm[i] != start){
+        column[i] = std::move(column[perm[i]]);
+        i = perm[i];
+    }
+    column[i] = std::move(temp);
+}
+
+//按perm原地重排任意多个列数组，每列的长度都是perm.size()
+template<typename... Columns>
+void apply_permutation(const vector<size_t>& perm, Columns*... columns){
+    size_t len = perm.size();
+    vector<bool> placed(len, false);
+    for(size_t start = 0; start < len; start++){
+        if(placed[start]){
+            continue;
+        }
+        if(perm[start] != start){
+            int expand[] = {0, (permutation_cycle(perm, start, columns), 0)...};
+            (void)expand;
+        }
+        for(size_t i = start; !placed[i]; i = perm[i]){
+            placed[i] = true;
+        }
+    }
+}
+
+//列存储的表按keys这一列排序，其余各列跟着重排
+template<typename K, typename... Columns>
+void soa_sort(K* keys, size_t len, Columns*... columns){
+    if(len <= 1){
+        return;
+    }
+    vector<size_t> perm = argsort(keys, len);
+    apply_permutation(perm, keys, columns...);
+}
+
+/*************************并行样本排序（sample sort）*************************
+ * 并行归并排序最后几层的融合都要把整个数组读写一遍，核数多了以后瓶颈在内存带宽上
+ * 样本排序是基于分配的并行排序，数据只需要搬动一次：
+ *      1）抽样：随机取OVERSAMPLE*B个数排好序，每隔OVERSAMPLE个取一个作为分割点（splitter），得到B-1个分割点，把数据分成B个桶
+ *      2）分类：分割点按完全二叉树的层序（Eytzinger）存放，找桶时 j = 2*j + (splitter[j] < x)，走log(B)层就得到桶号，
+ *         没有分支，并且每次交错处理4个数，让几条依赖链同时进行
+ *      3）每个线程负责一段数据，统计自己每个桶的个数，前缀和之后每个线程在每个桶中都有一段专属的写入区间
+ *      4）分配：每个线程为每个桶准备一个缓存行大小的写缓冲（write-combining），缓冲写满后整行写出，避免分散的小写入
+ *      5）每个桶互不相关，作为独立的任务用intro_sort排序，最后拷贝回原数组
+ * 重复的数很多时，很多分割点会相等，这些数全都落进同一个桶，最后只有一个线程在排序这个大桶。
+ * 所以抽样得到的分割点中有相等的时，先把分割点去重（最多保留127个），再给每个分割点加一个“等于桶”（IPS4o的做法）：
+ * 先照常找到桶号b（严格小于x的分割点个数），如果x等于第b个分割点就放进等于桶2b+1，否则放进2b；等于桶里的数都相等，不用排序
+ */
+const size_t SAMPLE_SORT_MIN = 1 << 16;//小于该长度直接intro_sort
+const int SAMPLE_SORT_MAX_LOG_BUCKETS = 8;//最多256个桶，桶号可以用一个字节存
+const size_t SAMPLE_SORT_OVERSAMPLE = 16;
+const size_t SAMPLE_SORT_MIN_BUCKET = 1 << 12;//平均每个桶至少这么多个数
+
+template<typename T, typename Compare>
+class SplitterTree{
+private:
+    int log_buckets;
+    vector<T> tree;//tree[1...B-1]，层序存放
+    Compare comp;
+
+    //按中序把有序的分割点填进完全二叉树
+    void build(const vector<T>& splitters, size_t node, size_t& next){
+        if(node >= tree.size()){
+            return;
+        }
+        build(splitters, 2 * node, next);
+        tree[node] = splitters[next++];
+        build(splitters, 2 * node + 1, next);
+    }
+
+public:
+    SplitterTree(const vector<T>& splitters, int log_b, Compare c) : log_buckets(log_b), tree((size_t)1 << log_b), comp(c) {
+        size_t next = 0;
+        build(splitters, 1, next);
+    }
+
+    //桶号 = 严格小于x的分割点个数
+    size_t classify(const T& x) const {
+        size_t j = 1;
+        for(int level = 0; level < log_buckets; level++){
+            j = 2 * j + (comp(tree[j], x) ? 1 : 0);
+        }
+        return j - tree.size();
+    }
+
+    //同时对四个数分类
+    void classify4(const T& a, const T& b, const T& c, const T& d, uint8_t* out) const {
+        size_t ja = 1, jb = 1, jc = 1, jd = 1;
+        for(int level = 0; level < log_buckets; level++){
+            ja = 2 * ja + (comp(tree[ja], a) ? 1 : 0);
+            jb = 2 * jb + (comp(tree[jb], b) ? 1 : 0);
+            jc = 2 * jc + (comp(tree[jc], c) ? 1 : 0);
+            jd = 2 * jd + (comp(tree[jd], d) ? 1 : 0);
+        }
+        out[0] = (uint8_t)(ja - tree.size());
+        out[1] = (uint8_t)(jb - tree.size());
+        out[2] = (uint8_t)(jc - tree.size());
+        out[3] = (uint8_t)(jd - tree.size());
+    }
+};
+
+//样本排序（不稳定）
+template<typename RandomIt, typename Compare>
+void sample_sort(RandomIt first, RandomIt last, Compare comp, ThreadPool& pool){
+    typedef typename iterator_traits<RandomIt>::value_type value_type;
+    size_t len = last - first;
+    if(len < SAMPLE_SORT_MIN || pool.concurrency() == 1){
+        intro_sort(first, last, comp);
+        return;
+    }
+    int log_buckets = SAMPLE_SORT_MAX_LOG_BUCKETS;
+    while(log_buckets > 1 && (len >> log_buckets) < SAMPLE_SORT_MIN_BUCKET){
+        log_buckets--;
+    }
+    size_t bucket_num = (size_t)1 << log_buckets;
+
+    //1）抽样选分割点
+    vector<value_type> sample(SAMPLE_SORT_OVERSAMPLE * bucket_num);
+    uint64_t state = 0x2545F4914F6CDD1Dull;
+    for(size_t i = 0; i < sample.size(); i++){
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        sample[i] = *(first + (ptrdiff_t)(state % len));
+    }
+    intro_sort(sample.begin(), sample.end(), comp);
+    vector<value_type> splitters(bucket_num - 1);
+    for(size_t i = 0; i + 1 < bucket_num; i++){
+        splitters[i] = sample[(i + 1) * SAMPLE_SORT_OVERSAMPLE - 1];
+    }
+    //分割点中有相等的时，去重并使用等于桶，桶的个数变为2S+1（S为不同的分割点个数）
+    bool equality_buckets = false;
+    for(size_t i = 0; i + 1 < splitters.size(); i++){
+        if(!comp(splitters[i], splitters[i + 1])){
+            equality_buckets = true;
+            break;
+        }
+    }
+    size_t unique_num = splitters.size();
+    if(equality_buckets){
+        vector<value_type> unique_splitters;
+        for(size_t i = 0; i < splitters.size(); i++){
+            if(unique_splitters.empty() || comp(unique_splitters.back(), splitters[i])){
+                unique_splitters.push_back(splitters[i]);
+            }
+        }
+        const size_t max_unique = ((size_t)1 << (SAMPLE_SORT_MAX_LOG_BUCKETS - 1)) - 1;//2S+1个桶号仍然要用一个字节存下
+        if(unique_splitters.size() > max_unique){
+            vector<value_type> kept(max_unique);
+            for(size_t i = 0; i < max_unique; i++){
+                kept[i] = unique_splitters[(i + 1) * unique_splitters.size() / (max_unique + 1)];
+            }
+            unique_splitters.swap(kept);
+        }
+        unique_num = unique_splitters.size();
+        log_buckets = 1;
+        while(((size_t)1 << log_buckets) - 1 < unique_num){
+            log_buckets++;
+        }
+        splitters = unique_splitters;
+        splitters.resize(((size_t)1 << log_buckets) - 1, unique_splitters.back());//用最大的分割点补满，补的部分只会让桶号超过unique_num
+        bucket_num = 2 * unique_num + 1;
+    }
+    SplitterTree<value_type, Compare> tree(splitters, log_buckets, comp);
+    auto equality_bucket = [&](size_t b, const value_type& x) -> uint8_t {
+        b = min(b, unique_num);
+        return (uint8_t)(2 * b + (b < unique_num && !comp(x, splitters[b]) ? 1 : 0));
+    };
+
+    //2）每个线程对自己那一段分类，并统计每个桶的个数
+    size_t chunk_num = pool.concurrency();
+    size_t chunk_len = (len + chunk_num - 1) / chunk_num;
+    vector<uint8_t> oracle(len);
+    vector<size_t> counts(chunk_num * bucket_num, 0);
+    parallel_for(0, chunk_num, 1, [&](size_t chunk_lo, size_t chunk_hi){
+        for(size_t chunk = chunk_lo; chunk < chunk_hi; chunk++){
+            size_t begin = chunk * chunk_len;
+            size_t end = min(begin + chunk_len, len);
+            size_t* count = &counts[chunk * bucket_num];
+            size_t i = begin;
+            for(; i + 4 <= end; i += 4){
+                tree.classify4(*(first + i), *(first + i + 1), *(first + i + 2), *(first + i + 3), &oracle[i]);
+            }
+            for(; i < end; i++){
+                oracle[i] = (uint8_t)tree.classify(*(first + i));
+            }
+            if(equality_buckets){
+                for(i = begin; i < end; i++){
+                    oracle[i] = equality_bucket(oracle[i], *(first + i));
+                }
+            }
+            for(i = begin; i < end; i++){
+                count[oracle[i]]++;
+            }
+        }
+    }, pool);
+
+    //3）前缀和：桶b中按线程编号依次排列，counts变为每个线程在每个桶中的写入起点
+    vector<size_t> bucket_begin(bucket_num + 1, 0);
+    size_t sum = 0;
+    for(size_t b = 0; b < bucket_num; b++){
+        bucket_begin[b] = sum;
+        for(size_t chunk = 0; chunk < chunk_num; chunk++){
+            size_t c = counts[chunk * bucket_num + b];
+            counts[chunk * bucket_num + b] = sum;
+            sum += c;
+        }
+    }
+    bucket_begin[bucket_num] = len;
+
+    //4）带写缓冲的并行分配
+    vector<value_type> buffer(len);
+    const size_t line = max<size_t>(CACHE_LINE_SIZE / sizeof(value_type), 1);
+    parallel_for(0, chunk_num, 1, [&](size_t chunk_lo, size_t chunk_hi){
+        vector<value_type> staging(bucket_num * line);
+        vector<size_t> filled(bucket_num);
+        for(size_t chunk = chunk_lo; chunk < chunk_hi; chunk++){
+            size_t begin = chunk * chunk_len;
+            size_t end = min(begin + chunk_len, len);
+            size_t* offset = &counts[chunk * bucket_num];
+            fill(filled.begin(), filled.end(), 0);
+            for(size_t i = begin; i < end; i++){
+                size_t b = oracle[i];
+                staging[b * line + filled[b]] = *(first + i);
+                if(++filled[b] == line){//缓冲写满，整行写出
+                    std::copy(staging.begin() + b * line, staging.begin() + (b + 1) * line, buffer.begin() + offset[b]);
+                    offset[b] += line;
+                    filled[b] = 0;
+                }
+            }
+            for(size_t b = 0; b < bucket_num; b++){
+                std::copy(staging.begin() + b * line, staging.begin() + b * line + filled[b], buffer.begin() + offset[b]);
+                offset[b] += filled[b];
+            }
+        }
+    }, pool);
+
+    //5）每个桶独立排序（等于桶不用排），再拷贝回原数组
+    TaskGroup group;
+    for(size_t b = 0; b < bucket_num; b++){
+        size_t begin = bucket_begin[b];
+        size_t end = bucket_begin[b + 1];
+        if(end - begin > 1 && !(equality_buckets && b % 2 == 1)){
+            pool.run(group, [&buffer, begin, end, comp]{
+                intro_sort(buffer.begin() + begin, buffer.begin() + end, comp);
+            });
+        }
+    }
+    pool.wait(group);
+    parallel_for(0, len, PARALLEL_SORT_GRAIN, [&](size_t lo, size_t hi){
+        std::copy(buffer.begin() + lo, buffer.begin() + hi, first + lo);
+    }, pool);
+}
+
+template<typename RandomIt, typename Compare>
+void sample_sort(RandomIt first, RandomIt last, Compare comp){
+    sample_sort(first, last, comp, ThreadPool::instance());
+}
+
+template<typename RandomIt>
+void sample_sort(RandomIt first, RandomIt last){
+    sample_sort(first, last, less<typename iterator_traits<RandomIt>::value_type>());
+}
+
+/*************************外排序*************************
+ * big_data_problem.cpp中问题3：10G的整数文件只有5G内存，输出排好序的新文件，上面所有排序都要求数据全部在内存中
+ * 外排序分两个阶段：
+ *      1）生成顺串：每次读入内存预算能容纳的数据，用基数排序排好后写成一个临时的顺串文件
+ *      2）多路归并：用败者树把最多fan_in个顺串归并成一个，顺串个数超过fan_in时先分组归并成更长的顺串，直到一次就能归并完
+ * 败者树每次取出最小值后只需要沿一条路径和log(k)个败者比较，比堆每层都要比较两个孩子要少
+ * 读写都按大块进行，并且每个文件有两块缓冲：当前块在被消费时，另一块由后台线程异步读取（写入时同理），磁盘和CPU可以同时工作
+ */
+struct ExternalSortConfig{
+    size_t memory_bytes;//内存预算
+    size_t fan_in;//一次归并的最大路数
+    string temp_dir;//临时顺串文件的目录
+    ExternalSortConfig() : memory_bytes((size_t)1 << 30), fan_in(64), temp_dir(".") {}
+};
+
+//带预读的顺序读取：消费当前块时后台线程读下一块
+template<typename T>
+class BlockReader{
+private:
+    FILE* file;
+    vector<T> current;
+    vector<T> prefetch;
+    size_t pos;
+    size_t count;
+    future<size_t> pending;
+    bool ok;
+
+    void start_prefetch(){
+        pending = async(launch::async, [this]{ return fread(prefetch.data(), sizeof(T), prefetch.size(), file); });
+    }
+
+    bool refill(){
+        if(!pending.valid()){
+            return false;
+        }
+        count = pending.get();
+        pos = 0;
+        std::swap(current, prefetch);
+        if(count == current.size()){//读满说明后面可能还有数据
+            start_prefetch();
+        }
+        else if(ferror(file)){//没读满可能是读到了文件末尾，也可能是读出错，出错时这一块的数据也不能用
+            ok = false;
+            count = 0;
+        }
+        return count > 0;
+    }
+
+public:
+    BlockReader() : file(nullptr), pos(0), count(0), ok(false) {}
+    ~BlockReader(){ close(); }
+    BlockReader(const BlockReader&) = delete;
+    BlockReader& operator=(const BlockReader&) = delete;
+
+    bool open(const string& path, size_t block_elements){
+        file = fopen(path.c_str(), "rb");
+        if(file == nullptr){
+            return false;
+        }
+        current.resize(block_elements);
+        prefetch.resize(block_elements);
+        ok = true;
+        start_prefetch();
+        return true;
+    }
+
+    //读到文件末尾或者读出错时返回false，用good区分这两种情况
+    bool next(T& value){
+        if(pos == count && !refill()){
+            return false;
+        }
+        value = current[pos++];
+        return true;
+    }
+
+    //到目前为止是否都没有读错误
+    bool good() const {
+        return ok;
+    }
+
+    void close(){
+        if(pending.valid()){
+            pending.wait();
+        }
+        if(file != nullptr){
+            fclose(file);
+            file = nullptr;
+        }
+    }
+};
+
+//带后台写入的顺序写：当前块写满后交给后台线程写盘，自己继续填另一块
+template<typename T>
+class BlockWriter{
+private:
+    FILE* file;
+    vector<T> current;
+    vector<T> writing;
+    size_t pos;
+    future<bool> pending;
+    bool ok;
+
+    void flush_async(){
+        if(pending.valid()){
+            ok = pending.get() && ok;
+        }
+        std::swap(current, writing);
+        size_t n = pos;
+        pos = 0;
+        pending = async(launch::async, [this, n]{ return fwrite(writing.data(), sizeof(T), n, file) == n; });
+    }
+
+public:
+    BlockWriter() : file(nullptr), pos(0), ok(false) {}
+    ~BlockWriter(){ close(); }
+    BlockWriter(const BlockWriter&) = delete;
+    BlockWriter& operator=(const BlockWriter&) = delete;
+
+    bool open(const string& path, size_t block_elements){
+        file = fopen(path.c_str(), "wb");
+        if(file == nullptr){
+            return false;
+        }
+        current.resize(block_elements);
+        writing.resize(block_elements);
+        ok = true;
+        return true;
+    }
+
+    void put(const T& value){
+        current[pos++] = value;
+        if(pos == current.size()){
+            flush_async();
+        }
+    }
+
+    //写完剩余数据并关闭文件，返回整个过程是否成功
+    bool close(){
+        if(file == nullptr){
+            return ok;
+        }
+        if(pos > 0){
+            flush_async();
+        }
+        if(pending.valid()){
+            ok = pending.get() && ok;
+        }
+        ok = fclose(file) == 0 && ok;
+        file = nullptr;
+        return ok;
+    }
+};
+
+//败者树：内部节点记录比赛的败者，tree[0]记录最终的胜者（最小值所在的路）
+template<typename T>
+class LoserTree{
+private:
+    int k;
+    vector<int> tree;
+    vector<T> keys;
+    vector<char> alive;//该路是否还有数据，没有数据的路视为无穷大
+
+    bool beats(int a, int b) const {
+        if(!alive[a]){
+            return false;
+        }
+        if(!alive[b]){
+            return true;
+        }
+        return keys[a] < keys[b] || (!(keys[b] < keys[a]) && a < b);
+    }
+
+public:
+    explicit LoserTree(int way_num) : k(way_num), tree(way_num, 0), keys(way_num), alive(way_num, 0) {}
+
+    void set(int way, const T& key){
+        keys[way] = key;
+        alive[way] = 1;
+    }
+
+    void exhaust(int way){
+        alive[way] = 0;
+    }
+
+    //所有路的初始值设置完之后自底向上建树，叶子节点编号为k...2k-1
+    void build(){
+        vector<int> winner(2 * k);
+        for(int node = 2 * k - 1; node >= k; node--){
+            winner[node] = node - k;
+        }
+        for(int node = k - 1; node >= 1; node--){
+            int a = winner[2 * node];
+            int b = winner[2 * node + 1];
+            winner[node] = beats(a, b) ? a : b;
+            tree[node] = beats(a, b) ? b : a;
+        }
+        tree[0] = k == 1 ? 0 : winner[1];
+    }
+
+    //胜者那一路的值更新后，沿着到根的路径重新比赛
+    void replay(int way){
+        int winner = way;
+        for(int node = (way + k) / 2; node >= 1; node /= 2){
+            if(beats(tree[node], winner)){
+                std::swap(tree[node], winner);
+            }
+        }
+        tree[0] = winner;
+    }
+
+    int top() const { return tree[0]; }
+    bool empty() const { return !alive[tree[0]]; }
+    const T& top_key() const { return keys[tree[0]]; }
+};
+
+//把若干个有序文件归并成一个有序文件
+template<typename T>
+bool merge_sorted_files(const vector<string>& inputs, const string& output, size_t block_elements){
+    int k = (int)inputs.size();
+    vector<unique_ptr<BlockReader<T>>> readers;
+    LoserTree<T> tree(k);
+    for(int i = 0; i < k; i++){
+        readers.emplace_back(new BlockReader<T>());
+        if(!readers[i]->open(inputs[i], block_elements)){
+            cout<<"cannot open "<<inputs[i]<<endl;
+            return false;
+        }
+        T value;
+        if(readers[i]->next(value)){
+            tree.set(i, value);
+        }
+        else if(!readers[i]->good()){
+            cout<<"cannot read "<<inputs[i]<<endl;
+            return false;
+        }
+    }
+    tree.build();
+
+    BlockWriter<T> writer;
+    if(!writer.open(output, block_elements)){
+        cout<<"cannot create "<<output<<endl;
+        return false;
+    }
+    while(!tree.empty()){
+        int way = tree.top();
+        writer.put(tree.top_key());
+        T value;
+        if(readers[way]->next(value)){
+            tree.set(way, value);
+        }
+        else if(!readers[way]->good()){//读错误不能当成这一路结束，否则输出会悄悄地少掉数据
+            cout<<"cannot read "<<inputs[way]<<endl;
+            writer.close();
+            return false;
+        }
+        else{
+            tree.exhaust(way);
+        }
+        tree.replay(way);
+    }
+    return writer.close();
+}
+
+//临时文件的前缀：时间、进程号和进程内的序号，同一秒内、同一目录下同时进行的多个外排序也不会用到同名的文件
+inline string external_sort_prefix(const string& temp_dir){
+    static atomic<unsigned> sequence(0);
+#if SORT_HAS_GETPID
+    unsigned long long pid = (unsigned long long)getpid();
+#else
+    unsigned long long pid = 0;
+#endif
+    return temp_dir + "/external_sort_" + to_string((unsigned long long)time(NULL)) + "_" + to_string(pid) + "_" + to_string(sequence++) + "_";
+}
+
+//外排序：input和output都是T类型的二进制文件
+template<typename T>
+bool external_sort(const string& input, const string& output, const ExternalSortConfig& config){
+    size_t fan_in = max<size_t>(config.fan_in, 2);
+    size_t run_elements = max<size_t>(config.memory_bytes / (2 * sizeof(T)), 1);//基数排序需要等长的辅助空间
+    string prefix = external_sort_prefix(config.temp_dir);
+
+    //1）生成顺串
+    FILE* in = fopen(input.c_str(), "rb");
+    if(in == nullptr){
+        cout<<"cannot open "<<input<<endl;
+        return false;
+    }
+    vector<string> runs;
+    {
+        vector<T> chunk(run_elements);
+        while(true){
+            size_t n = fread(chunk.data(), sizeof(T), run_elements, in);
+            if(n < run_elements && ferror(in)){
+                cout<<"cannot read "<<input<<endl;
+                fclose(in);
+                for(auto& run : runs){
+                    remove(run.c_str());
+                }
+                return false;
+            }
+            if(n == 0){
+                break;
+            }
+            radix_sort(chunk.data(), chunk.data() + n);
+            string path = prefix + "0_" + to_string((unsigned long long)runs.size()) + ".run";
+            FILE* out = fopen(path.c_str(), "wb");
+            bool written = out != nullptr && fwrite(chunk.data(), sizeof(T), n, out) == n;
+            if(out != nullptr){
+                written = fclose(out) == 0 && written;
+            }
+            runs.push_back(path);
+            if(!written){
+                cout<<"cannot write "<<path<<endl;
+                fclose(in);
+                for(auto& run : runs){
+                    remove(run.c_str());
+                }
+                return false;
+            }
+        }
+    }
+    fclose(in);
+    if(runs.empty()){//空文件直接输出空文件
+        FILE* out = fopen(output.c_str(), "wb");
+        if(out == nullptr){
+            cout<<"cannot create "<<output<<endl;
+            return false;
+        }
+        return fclose(out) == 0;
+    }
+
+    //2）多路归并，每一路读、写各两块缓冲
+    size_t block_elements = max<size_t>(config.memory_bytes / (sizeof(T) * 2 * (fan_in + 1)), 1024);
+    bool ok = true;
+    for(int pass = 1; ok && runs.size() > fan_in; pass++){
+        vector<string> next_runs;
+        for(size_t begin = 0; ok && begin < runs.size(); begin += fan_in){
+            vector<string> group(runs.begin() + begin, runs.begin() + min(begin + fan_in, runs.size()));
+            string path = prefix + to_string(pass) + "_" + to_string((unsigned long long)next_runs.size()) + ".run";
+            ok = merge_sorted_files<T>(group, path, block_elements);
+            next_runs.push_back(path);
+            for(auto& run : group){
+                remove(run.c_str());
+            }
+        }
+        if(!ok){
+            for(size_t i = next_runs.size() * fan_in; i < runs.size(); i++){
+                remove(runs[i].c_str());
+            }
+        }
+        runs = next_runs;
+    }
+    if(ok){
+        ok = merge_sorted_files<T>(runs, output, block_elements);
+    }
+    for(auto& run : runs){
+        remove(run.c_str());
+    }
+    return ok;
+}
+
+//命令行：sort external <input> <output> [u32|u64] [memory_mb] [fan_in] [temp_dir]
+int run_external_sort(int argc, char* argv[]){
+    if(argc < 4){
+        cout<<"usage: "<<argv[0]<<" external <input> <output> [u32|u64] [memory_mb] [fan_in] [temp_dir]"<<endl;
+        return 1;
+    }
+    string type = argc > 4 ? argv[4] : "u32";
+    ExternalSortConfig config;
+    if(argc > 5){
+        config.memory_bytes = (size_t)atoll(argv[5]) << 20;
+    }
+    if(argc > 6){
+        config.fan_in = (size_t)atoll(argv[6]);
+    }
+    if(argc > 7){
+        config.temp_dir = argv[7];
+    }
+    bool ok;
+    if(type == "u32"){
+        ok = external_sort<uint32_t>(argv[2], argv[3], config);
+    }
+    else if(type == "u64"){
+        ok = external_sort<uint64_t>(argv[2], argv[3], config);
+    }
+    else{
+        cout<<"unknown key type "<<type<<endl;
+        return 1;
+    }
+    cout<<(ok ? "done..." : "failed...")<<endl;
+    return ok ? 0 : 1;
+}
+
+/*************************排序基准测试*************************
+ * 命令行：sort bench [csv|json] [max_len]
+ * 对每一种排序（以及std::sort/std::stable_sort作为基准），在1K到100M的长度、多种输入分布上运行，输出：
+ *      ns/element：每个元素的平均耗时，小数组重复多次取平均
+ *      comparisons、moves：用会计数的CountedInt类型再跑一遍模板版本的排序得到（moves为元素的拷贝/移动赋值次数，一次交换约为3次），
+ *                           基数排序、计数排序不做比较，记为-1
+ *      allocations、allocated_bytes：排序过程中operator new的调用次数和申请的字节数
+ *      peak_rss_kb：排序过程中的内存峰值（Linux下通过/proc/self/clear_refs重置峰值）
+ * 输入分布：均匀随机、有序、逆序、先增后减（organ-pipe）、少量不同值、Zipf分布、基本有序（1%的位置被随机交换）
+ */
+atomic<size_t> allocation_count(0);
+atomic<size_t> allocation_bytes(0);
+
+void* operator new(size_t size){
+    allocation_count.fetch_add(1, memory_order_relaxed);
+    allocation_bytes.fetch_add(size, memory_order_relaxed);
+    void* p = malloc(size == 0 ? 1 : size);
+    if(p == nullptr){
+        throw bad_alloc();
+    }
+    return p;
+}
+
+//不能内联：否则GCC会把内联后的free与调用处的new配对而误报-Wmismatched-new-delete
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+//统计比较次数和赋值次数的int
+struct CountedInt{
+    int value;
+    static atomic<size_t> comparisons;
+    static atomic<size_t> moves;
+
+    CountedInt() : value(0) {}
+    explicit CountedInt(int v) : value(v) {}
+    CountedInt(const CountedInt& other) : value(other.value) {
+        moves.fetch_add(1, memory_order_relaxed);
+    }
+    CountedInt& operator=(const CountedInt& other){
+        value = other.value;
+        moves.fetch_add(1, memory_order_relaxed);
+        return *this;
+    }
+    bool operator<(const CountedInt& other) const {
+        comparisons.fetch_add(1, memory_order_relaxed);
+        return value < other.value;
+    }
+};
+atomic<size_t> CountedInt::comparisons(0);
+atomic<size_t> CountedInt::moves(0);
+
+//重置并读取进程的内存峰值（KB）
+void reset_peak_rss(){
+#ifdef __linux__
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if(file != nullptr){
+        fputs("5", file);
+        fclose(file);
+    }
+#endif
+}
+
+long peak_rss_kb(){
+#ifdef __linux__
+    FILE* file = fopen("/proc/self/status", "r");
+    if(file != nullptr){
+        char line[256];
+        long value = -1;
+        while(fgets(line, sizeof(line), file) != nullptr){
+            if(strncmp(line, "VmHWM:", 6) == 0){
+                value = atol(line + 6);
+                break;
+            }
+        }
+        fclose(file);
+        return value;
+    }
+#endif
+    return -1;
+}
+
+const char* BENCH_DISTRIBUTIONS[] = {"uniform", "sorted", "reverse", "organ_pipe", "few_unique", "zipf", "nearly_sorted"};
+const int BENCH_DISTRIBUTION_NUM = 7;
+
+//生成某种分布的输入
+vector<int> generate_bench_input(const string& distribution, size_t len, uint64_t seed){
+    mt19937_64 rng(seed);
+    vector<int> data(len);
+    if(distribution == "uniform"){
+        for(auto& x : data){
+            x = (int)(rng() >> 33);
+        }
+    }
+    else if(distribution == "sorted" || distribution == "reverse" || distribution == "nearly_sorted"){
+        for(size_t i = 0; i < len; i++){
+            data[i] = (int)i;
+        }
+        if(distribution == "reverse"){
+            reverse(data.begin(), data.end());
+        }
+        if(distribution == "nearly_sorted"){
+            for(size_t k = 0; k < len / 100; k++){
+                std::swap(data[rng() % len], data[rng() % len]);
+            }
+        }
+    }
+    else if(distribution == "organ_pipe"){
+        for(size_t i = 0; i < len; i++){
+            data[i] = (int)min(i, len - 1 - i);
+        }
+    }
+    else if(distribution == "few_unique"){
+        for(auto& x : data){
+            x = (int)(rng() % 16);
+        }
+    }
+    else if(distribution == "zipf"){//s=1的Zipf分布，在前缀和上二分取值
+        size_t value_num = max<size_t>(min<size_t>(len, 1000000), 1);
+        vector<double> cdf(value_num);
+        double sum = 0;
+        for(size_t i = 0; i < value_num; i++){
+            sum += 1.0 / (i + 1);
+            cdf[i] = sum;
+        }
+        uniform_real_distribution<double> uniform(0, sum);
+        for(auto& x : data){
+            x = (int)(lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin());
+        }
+    }
+    return data;
+}
+
+struct SortBenchCase{
+    const char* name;
+    void (*run)(vector<int>&);
+    void (*run_counted)(vector<CountedInt>&);//为空表示不统计比较和赋值次数
+    size_t max_len;//O(n^2)的排序只在小数组上运行
+};
+
+vector<SortBenchCase> sort_bench_cases(){
+    const size_t unlimited = numeric_limits<size_t>::max();
+    vector<SortBenchCase> cases = {
+        {"insert_sort", [](vector<int>& v){ insert_sort(v.data(), (int)v.size()); },
+                [](vector<CountedInt>& v){ insertion_sort(v.begin(), v.end(), less<CountedInt>()); }, 20000},
+        {"merge_sort", [](vector<int>& v){ merge_sort(v.begin(), v.end()); },
+                [](vector<CountedInt>& v){ merge_sort(v.begin(), v.end()); }, unlimited},
+        {"merge_sort_bottom_up", [](vector<int>& v){ merge_sort_bottom_up(v.begin(), v.end()); },
+                [](vector<CountedInt>& v){ merge_sort_bottom_up(v.begin(), v.end()); }, unlimited},
+        {"parallel_merge_sort", [](vector<int>& v){ parallel_merge_sort(v.begin(), v.end()); },
+                [](vector<CountedInt>& v){ parallel_merge_sort(v.begin(), v.end()); }, unlimited},
+        {"quick_process", [](vector<int>& v){ if(v.size() > 1){ quick_process(v.data(), 0, (int)v.size() - 1); } },
+                nullptr, unlimited},
+        {"quick_sort", [](vector<int>& v){ intro_sort(v.begin(), v.end()); },
+                [](vector<CountedInt>& v){ intro_sort(v.begin(), v.end()); }, unlimited},
+        {"heap_sort", [](vector<int>& v){ heap_sort(v.data(), (int)v.size()); },
+                [](vector<CountedInt>& v){ heap_sort(v.begin(), v.end(), less<CountedInt>()); }, unlimited},
+        {"count_sort", [](vector<int>& v){ count_sort(v.data(), (int)v.size()); }, nullptr, unlimited},
+        {"bucket_sort", [](vector<int>& v){ bucket_sort(v.data(), (int)v.size()); }, nullptr, unlimited},
+        {"sample_sort", [](vector<int>& v){ sample_sort(v.begin(), v.end()); },
+                [](vector<CountedInt>& v){ sample_sort(v.begin(), v.end()); }, unlimited},
+        {"std::sort", [](vector<int>& v){ std::sort(v.begin(), v.end()); },
+                [](vector<CountedInt>& v){ std::sort(v.begin(), v.end()); }, unlimited},
+        {"std::stable_sort", [](vector<int>& v){ std::stable_sort(v.begin(), v.end()); },
+                [](vector<CountedInt>& v){ std::stable_sort(v.begin(), v.end()); }, unlimited},
+    };
+    return cases;
+}
+
+struct SortBenchResult{
+    string algorithm;
+    string distribution;
+    size_t len;
+    double ns_per_element;
+    long long comparisons;
+    long long moves;
+    size_t allocations;
+    size_t allocated_bytes;
+    long peak_rss_kb;
+    bool sorted;
+};
+
+SortBenchResult run_sort_bench(const SortBenchCase& sort_case, const string& distribution, const vector<int>& input){
+    SortBenchResult result;
+    result.algorithm = sort_case.name;
+    result.distribution = distribution;
+    result.len = input.size();
+    result.sorted = true;
+
+    //小数组重复多次（最多重复到累计0.2秒），每次都从原始输入开始，拷贝的时间不计入
+    size_t max_repeat = max<size_t>(1, min<size_t>(1000, 1000000 / max<size_t>(input.size(), 1)));
+    size_t repeat = 0;
+    double seconds = 0;
+    vector<int> data;
+    for(size_t r = 0; r < max_repeat && (r == 0 || seconds < 0.2); r++, repeat++){
+        data = input;
+        if(r == 0){
+            reset_peak_rss();
+            allocation_count = 0;
+            allocation_bytes = 0;
+        }
+        auto start = chrono::steady_clock::now();
+        sort_case.run(data);
+        seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if(r == 0){
+            result.allocations = allocation_count.load();
+            result.allocated_bytes = allocation_bytes.load();
+            result.peak_rss_kb = peak_rss_kb();
+            result.sorted = is_sorted(data.begin(), data.end());
+        }
+    }
+    result.ns_per_element = seconds * 1e9 / repeat / max<size_t>(input.size(), 1);
+
+    result.comparisons = -1;
+    result.moves = -1;
+    if(sort_case.run_counted != nullptr){
+        vector<CountedInt> counted(input.begin(), input.end());
+        CountedInt::comparisons = 0;
+        CountedInt::moves = 0;
+        sort_case.run_counted(counted);
+        result.comparisons = (long long)CountedInt::comparisons.load();
+        result.moves = (long long)CountedInt::moves.load();
+    }
+    return result;
+}
+
+void print_sort_bench(const SortBenchResult& r, bool json, bool first){
+    if(json){
+        cout<<(first ? "  " : ",\n  ")<<"{\"algorithm\": \""<<r.algorithm<<"\", \"distribution\": \""<<r.distribution<<"\", \"n\": "<<r.len
+            <<", \"ns_per_element\": "<<r.ns_per_element<<", \"comparisons\": "<<r.comparisons<<", \"moves\": "<<r.moves
+            <<", \"allocations\": "<<r.allocations<<", \"allocated_bytes\": "<<r.allocated_bytes<<", \"peak_rss_kb\": "<<r.peak_rss_kb
+            <<", \"sorted\": "<<(r.sorted ? "true" : "false")<<"}";
+    }
+    else{
+        cout<<r.algorithm<<","<<r.distribution<<","<<r.len<<","<<r.ns_per_element<<","<<r.comparisons<<","<<r.moves<<","
+            <<r.allocations<<","<<r.allocated_bytes<<","<<r.peak_rss_kb<<","<<(r.sorted ? "true" : "false")<<endl;
+    }
+}
+
+int run_sort_benchmark(int argc, char* argv[]){
+    bool json = argc > 2 && string(argv[2]) == "json";
+    size_t max_len = argc > 3 ? (size_t)atoll(argv[3]) : 100000000;
+    vector<SortBenchCase> cases = sort_bench_cases();
+    if(json){
+        cout<<"["<<endl;
+    }
+    else{
+        cout<<"algorithm,distribution,n,ns_per_element,comparisons,moves,allocations,allocated_bytes,peak_rss_kb,sorted"<<endl;
+    }
+    bool first = true;
+    for(size_t len = 1000; len <= max_len; len *= 10){
+        for(int d = 0; d < BENCH_DISTRIBUTION_NUM; d++){
+            vector<int> input = generate_bench_input(BENCH_DISTRIBUTIONS[d], len, 42 + d);
+            for(const SortBenchCase& sort_case : cases){
+                if(len > sort_case.max_len){
+                    continue;
+                }
+                print_sort_bench(run_sort_bench(sort_case, BENCH_DISTRIBUTIONS[d], input), json, first);
+                first = false;
+            }
+        }
+    }
+    if(json){
+        cout<<endl<<"]"<<endl;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]){
+	if(argc > 1 && string(argv[1]) == "external"){
+		return run_external_sort(argc, argv);
+	}
+	if(argc > 1 && string(argv[1]) == "bench"){
+		return run_sort_benchmark(argc, argv);
+	}
+	if(argc > 1 && string(argv[1]) == "heap-bench"){
+		benchmark_heap_sort(argc > 2 ? (size_t)atoll(argv[2]) : 10000000);
+		return 0;
+	}
 	int arr[9] = {1,30,2,6,8,5,4,9,7};
 	int len = sizeof(arr)/sizeof(int);
 	srand(time(NULL));
     bucket_sort(arr, len);
-//    cout<<count_num_max_len(arr, len)<<endl;
 	for(int i = 0; i < len; i++){
 		cout<<arr[i]<<endl;
 	}
@@ -1,10 +1,44 @@
 #include<iostream>
+#include<vector>
+#include<string>
+#include<thread>
+#include<chrono>
+#include<random>
+#include<algorithm>
+#include<cstdint>
+#include<cstdlib>
+#include<cstdio>
+#include<type_traits>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define XOR_HAS_AVX2_KERNEL 1
+#include<immintrin.h>
+#else
+#define XOR_HAS_AVX2_KERNEL 0
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#define XOR_HAS_MMAP 1
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+#else
+#define XOR_HAS_MMAP 0
+#endif
 
 using namespace std;
 
 void swap(int &a, int &b);
-int find1(int arr[]);
-void find2(int arr[]);
+int find1(int arr[], int len);
+void find2(int arr[], int len);
+template<typename T>
+T xor_reduce(const T* data, size_t len, unsigned thread_num = 0);//并行求所有数的异或和
+template<typename T>
+bool xor_find_two(const T* data, size_t len, T& first, T& second, unsigned thread_num = 0);//找出出现奇数次的两个数
+template<typename T>
+bool xor_reduce_file(const char* path, T& result, unsigned thread_num = 0);//对uint32/uint64的二进制文件求异或和
+template<typename T>
+bool xor_find_two_file(const char* path, T& first, T& second, unsigned thread_num = 0);//在二进制文件中找出出现奇数次的两个数
+void benchmark_xor(size_t len);//比较逐个异或和多线程SIMD异或
 
 void swap(int &a, int &b){
 	a = a ^ b;
@@ -13,7 +47,35 @@ void swap(int &a, int &b){
 }
 
 
-int main(){
+int main(int argc, char* argv[]){
+	if(argc > 1 && string(argv[1]) == "xor-bench"){
+		benchmark_xor(argc > 2 ? (size_t)atoll(argv[2]) : 100000000);
+		return 0;
+	}
+	if(argc > 2 && (string(argv[1]) == "xor" || string(argv[1]) == "xor2")){//swapbybitwise xor|xor2 <file> [u32|u64]
+		bool wide = argc > 3 && string(argv[3]) == "u64";
+		bool two = string(argv[1]) == "xor2";
+		bool ok;
+		if(wide){
+			uint64_t first = 0, second = 0;
+			ok = two ? xor_find_two_file<uint64_t>(argv[2], first, second) : xor_reduce_file<uint64_t>(argv[2], first);
+			if(ok){
+				cout<<"odd1:"<<first<<(two ? "\nodd2:" + to_string(second) : "")<<endl;
+			}
+		}
+		else{
+			uint32_t first = 0, second = 0;
+			ok = two ? xor_find_two_file<uint32_t>(argv[2], first, second) : xor_reduce_file<uint32_t>(argv[2], first);
+			if(ok){
+				cout<<"odd1:"<<first<<(two ? "\nodd2:" + to_string(second) : "")<<endl;
+			}
+		}
+		if(!ok){
+			cout<<"cannot read "<<argv[2]<<(two ? " or no two odd values" : "")<<endl;
+			return 1;
+		}
+		return 0;
+	}
 //	int a = 10;
 //	int b = 12;
 //	swap(a, b);
@@ -21,41 +83,272 @@ int main(){
 //	return 0;
 	int arr[12] = {1,1,1,1,1,2,2,2,3,3,2,2};
 //	cout<<sizeof(arr)<<endl;
-	find2(arr);
+	find2(arr, 12);
 	return 0;
 }
 
 
 //（1）一个数组中存在一个数出现奇数次，其他数出现偶数次，请找出出现奇次数的数
 //（2）一个数组中存在两个数出现奇数次，其他数出现偶数次，请找出出现奇次数的数
-int find1(int arr[]){
-	int error = 0;
-	for(int i = 0; i < 12; i++){
-		error = error ^ arr[i];
-	}
-	return error;
+int find1(int arr[], int len){
+	return (int)xor_reduce((const uint32_t*)arr, (size_t)len);
 }
 
 
-void find2(int arr[]){
-	int error = 0;
-	for(int i = 0; i < 12; i++){
-		error = error ^ arr[i];
+void find2(int arr[], int len){
+	uint32_t odd1, odd2;
+	if(!xor_find_two((const uint32_t*)arr, (size_t)len, odd1, odd2)){
+		cout<<"no two odd values"<<endl;
+		return;
 	}
-	// 计算最右边不为0的位
-	int rightOne = ~error + 1;
-	rightOne = error & rightOne;
+	cout<<"odd1:"<<(int)odd1<<endl;
+	cout<<"odd2:"<<(int)odd2<<endl;
+}
 
-	int onlyOne = 0;
-	for(int i = 0; i < 12; i++){
-		if((arr[i] & rightOne) == 1){ // 只与上面计算同样位置不为0的数相与
-			onlyOne = onlyOne ^ arr[i];
+
+/*************************大数组上的异或归约*************************
+ * find1、find2原来写死了12个数，这里改成可以处理任意长度（包括内存映射的超大文件）的库函数：
+ *      1）异或满足交换律、结合律，所以可以任意切块：数组切成和线程数一样多的段，每段的异或和再异或起来
+ *      2）每段内用AVX2一次读128字节，异或到4个256位的寄存器里（4个寄存器互不依赖，可以同时执行），
+ *         最后4个寄存器异或成一个，再把其中的32/sizeof(T)个数异或起来；不足128字节的尾巴逐个异或
+ *      3）找两个数时，先求出所有数的异或和eor = a ^ b，a != b所以eor不为0，取出最右边的1（eor & (~eor + 1)），
+ *         a和b在这一位上一个是1一个是0；第二遍只异或这一位是1的数（向量化时与上这一位、和0比较得到掩码），得到的就是其中一个
+ * 文件按uint32/uint64的二进制格式连续存放，支持mmap时直接映射，否则按块读进来（找两个数要读两遍）
+ */
+const size_t XOR_PARALLEL_MIN = 1 << 20;//每个线程至少处理这么多个数
+const size_t XOR_FILE_BLOCK = 1 << 20;//不支持mmap时每次读入的个数
+
+inline bool xor_has_avx2(){
+#if XOR_HAS_AVX2_KERNEL
+	static const bool supported = __builtin_cpu_supports("avx2");
+	return supported;
+#else
+	return false;
+#endif
+}
+
+//只异或(value & bit) != 0的数，bit为0时异或所有数
+template<typename T>
+T xor_range_scalar(const T* data, size_t len, T bit){
+	T result = 0;
+	if(bit == 0){
+		for(size_t i = 0; i < len; i++){
+			result ^= data[i];
 		}
 	}
-	cout<<"odd1:"<<onlyOne<<endl;
-	onlyOne = error ^ onlyOne;
-	cout<<"odd2:"<<onlyOne<<endl;
+	else{
+		for(size_t i = 0; i < len; i++){
+			result ^= data[i] & (T)(0 - (T)((data[i] & bit) != 0));
+		}
+	}
+	return result;
+}
+
+#if XOR_HAS_AVX2_KERNEL
+//每个通道和0比较
+__attribute__((target("avx2"))) inline __m256i xor_zero_lanes(__m256i v, uint32_t){
+	return _mm256_cmpeq_epi32(v, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"))) inline __m256i xor_zero_lanes(__m256i v, uint64_t){
+	return _mm256_cmpeq_epi64(v, _mm256_setzero_si256());
+}
+
+//只选出(value & bit) != 0的通道，bit为0时选出所有通道
+template<typename T>
+__attribute__((target("avx2"))) inline __m256i xor_select(__m256i v, __m256i bit, bool all){
+	return all ? v : _mm256_andnot_si256(xor_zero_lanes(_mm256_and_si256(v, bit), T()), v);
+}
+
+template<typename T>
+__attribute__((target("avx2"))) T xor_range_avx2(const T* data, size_t len, T bit){
+	const size_t lanes = 32 / sizeof(T);
+	const bool all = bit == 0;
+	__m256i bit_v = sizeof(T) == 4 ? _mm256_set1_epi32((int)bit) : _mm256_set1_epi64x((long long)bit);
+	__m256i acc0 = _mm256_setzero_si256();
+	__m256i acc1 = _mm256_setzero_si256();
+	__m256i acc2 = _mm256_setzero_si256();
+	__m256i acc3 = _mm256_setzero_si256();
+	size_t i = 0;
+	for(; i + 4 * lanes <= len; i += 4 * lanes){
+		const __m256i* p = (const __m256i*)(data + i);
+		acc0 = _mm256_xor_si256(acc0, xor_select<T>(_mm256_loadu_si256(p), bit_v, all));
+		acc1 = _mm256_xor_si256(acc1, xor_select<T>(_mm256_loadu_si256(p + 1), bit_v, all));
+		acc2 = _mm256_xor_si256(acc2, xor_select<T>(_mm256_loadu_si256(p + 2), bit_v, all));
+		acc3 = _mm256_xor_si256(acc3, xor_select<T>(_mm256_loadu_si256(p + 3), bit_v, all));
+	}
+	__m256i acc = _mm256_xor_si256(_mm256_xor_si256(acc0, acc1), _mm256_xor_si256(acc2, acc3));
+	T lane_values[32 / sizeof(T)];
+	_mm256_storeu_si256((__m256i*)lane_values, acc);
+	T result = xor_range_scalar(data + i, len - i, bit);
+	for(size_t k = 0; k < lanes; k++){
+		result ^= lane_values[k];
+	}
+	return result;
+}
+#endif
+
+template<typename T>
+T xor_range(const T* data, size_t len, T bit, bool avx2){
+#if XOR_HAS_AVX2_KERNEL
+	if(avx2 && (sizeof(T) == 4 || sizeof(T) == 8)){
+		typedef typename conditional<sizeof(T) == 4, uint32_t, uint64_t>::type lane_type;
+		return (T)xor_range_avx2<lane_type>((const lane_type*)data, len, (lane_type)bit);
+	}
+#endif
+	(void)avx2;
+	return xor_range_scalar(data, len, bit);
+}
+
+//切段多线程执行，各段的结果异或起来
+template<typename T>
+T xor_parallel(const T* data, size_t len, T bit, unsigned thread_num){
+	static_assert(is_integral<T>::value && is_unsigned<T>::value, "xor reduction needs unsigned integers");
+	bool avx2 = xor_has_avx2();
+	if(thread_num == 0){
+		thread_num = max(thread::hardware_concurrency(), 1u);
+	}
+	size_t chunk_num = min<size_t>(thread_num, max<size_t>(len / XOR_PARALLEL_MIN, 1));
+	if(chunk_num <= 1){
+		return xor_range(data, len, bit, avx2);
+	}
+	size_t chunk_len = (len + chunk_num - 1) / chunk_num;
+	vector<T> partial(chunk_num, 0);
+	vector<thread> workers;
+	for(size_t chunk = 1; chunk < chunk_num; chunk++){
+		workers.emplace_back([=, &partial]{
+			size_t lo = chunk * chunk_len;
+			partial[chunk] = xor_range(data + lo, min(chunk_len, len - lo), bit, avx2);
+		});
+	}
+	partial[0] = xor_range(data, chunk_len, bit, avx2);
+	for(thread& worker : workers){
+		worker.join();
+	}
+	T result = 0;
+	for(T value : partial){
+		result ^= value;
+	}
+	return result;
+}
+
+template<typename T>
+T xor_reduce(const T* data, size_t len, unsigned thread_num){
+	return xor_parallel(data, len, (T)0, thread_num);
+}
+
+//计算最右边不为0的位
+template<typename T>
+T xor_lowest_bit(T eor){
+	return eor & (~eor + 1);
+}
+
+//结果按从小到大返回，所有数的异或和为0（不存在两个出现奇数次的数）时返回false
+template<typename T>
+bool xor_find_two(const T* data, size_t len, T& first, T& second, unsigned thread_num){
+	T eor = xor_reduce(data, len, thread_num);
+	if(eor == 0){
+		return false;
+	}
+	T only_one = xor_parallel(data, len, xor_lowest_bit(eor), thread_num);
+	first = min<T>(only_one, eor ^ only_one);
+	second = max<T>(only_one, eor ^ only_one);
+	return true;
+}
+
+//对文件中的每一块数据调用f(data, len)，支持mmap时整个文件就是一块
+template<typename T, typename F>
+bool for_each_file_block(const char* path, F f){
+#if XOR_HAS_MMAP
+	int fd = open(path, O_RDONLY);
+	if(fd < 0){
+		return false;
+	}
+	struct stat info;
+	if(fstat(fd, &info) != 0){
+		close(fd);
+		return false;
+	}
+	size_t len = (size_t)info.st_size / sizeof(T);
+	if(len == 0){
+		close(fd);
+		return true;
+	}
+	void* mapped = mmap(nullptr, len * sizeof(T), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(mapped == MAP_FAILED){
+		return false;
+	}
+	madvise(mapped, len * sizeof(T), MADV_SEQUENTIAL);
+	f((const T*)mapped, len);
+	munmap(mapped, len * sizeof(T));
+	return true;
+#else
+	FILE* file = fopen(path, "rb");
+	if(file == nullptr){
+		return false;
+	}
+	vector<T> buffer(XOR_FILE_BLOCK);
+	size_t count;
+	while((count = fread(buffer.data(), sizeof(T), buffer.size(), file)) > 0){
+		f((const T*)buffer.data(), count);
+	}
+	fclose(file);
+	return true;
+#endif
+}
+
+template<typename T>
+bool xor_reduce_file(const char* path, T& result, unsigned thread_num){
+	result = 0;
+	return for_each_file_block<T>(path, [&](const T* data, size_t len){
+		result ^= xor_reduce(data, len, thread_num);
+	});
+}
+
+template<typename T>
+bool xor_find_two_file(const char* path, T& first, T& second, unsigned thread_num){
+	T eor;
+	if(!xor_reduce_file(path, eor, thread_num) || eor == 0){
+		return false;
+	}
+	T bit = xor_lowest_bit(eor);
+	T only_one = 0;
+	if(!for_each_file_block<T>(path, [&](const T* data, size_t len){
+		only_one ^= xor_parallel(data, len, bit, thread_num);
+	})){
+		return false;
+	}
+	first = min<T>(only_one, eor ^ only_one);
+	second = max<T>(only_one, eor ^ only_one);
+	return true;
 }
 
+//每个数出现两次，再加上两个只出现一次的数，打乱以后比较逐个异或和多线程SIMD异或
+void benchmark_xor(size_t len){
+	mt19937_64 rng(5);
+	vector<uint64_t> ids(len);
+	for(size_t i = 0; i + 1 < len; i += 2){
+		ids[i] = ids[i + 1] = rng();
+	}
+	uint64_t odd1 = 12345, odd2 = 67890;
+	ids.push_back(odd1);
+	ids.push_back(odd2);
+	shuffle(ids.begin(), ids.end(), rng);
 
+	auto start = chrono::steady_clock::now();
+	uint64_t scalar = xor_range_scalar(ids.data(), ids.size(), (uint64_t)0);
+	double scalar_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	start = chrono::steady_clock::now();
+	uint64_t parallel = xor_reduce(ids.data(), ids.size());
+	double parallel_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	start = chrono::steady_clock::now();
+	uint64_t first = 0, second = 0;
+	bool found = xor_find_two(ids.data(), ids.size(), first, second);
+	double two_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
+	cout<<"len = "<<ids.size()<<endl;
+	cout<<"scalar xor: "<<scalar_time * 1e9 / ids.size()<<" ns/element"<<endl;
+	cout<<"parallel"<<(xor_has_avx2() ? " avx2" : "")<<" xor: "<<parallel_time * 1e9 / ids.size()<<" ns/element"<<(parallel == scalar ? "" : " (wrong)")<<endl;
+	cout<<"find two: "<<two_time * 1e9 / ids.size()<<" ns/element"<<(found && first == odd1 && second == odd2 ? "" : " (wrong)")<<endl;
+}
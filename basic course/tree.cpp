@@ -19,7 +19,11 @@
  * 11.（问题8）求某一个节点的后继节点
  * 12.（问题9）树的序列化和反序列化
  * 13.（问题10）微软原题：折纸问题——将一张纸对折n次，打印折痕
- * 最近修改日期：2022-10-31
+ * 14.树的二进制序列化格式（varint/zigzag编码的值和按位存放的空节点），非递归编码和流式解码
+ * 15.最低公共祖先的索引：O(1)查询、倍增求第k个祖先、离线Tarjan批量查询
+ * 16.放在连续数组中、用32位下标连接的树（BFS或vEB顺序），以及遍历和问题1-6在这种树上的实现
+ * 17.树型DP的框架（非递归、大的子树分给多个线程），问题3、5、6作为它的实例
+ * 最近修改日期：2026-10-18
  *
  * @author   Zhou Junping
  * @email    zhoujunpingnn@gmail.com
@@ -34,6 +38,28 @@
 #include<cstring>
 #include<string>
 #include<cmath>
+#include<vector>
+#include<random>
+#include<chrono>
+#include<cstdint>
+#include<cstdio>
+#include<cstdlib>
+#include<cerrno>
+#include<algorithm>
+#include<stdexcept>
+#include<thread>
+#include<atomic>
+#include<mutex>
+#include<type_traits>
+#if defined(__unix__) || defined(__APPLE__)
+#define TREE_HAS_MMAP 1
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+#else
+#define TREE_HAS_MMAP 0
+#endif
 
 using namespace std;
 
@@ -74,15 +100,26 @@ bool question4(Node* head);//如何判断一棵树是完全二叉树
 bool question5(Node* head);//如何判断一棵树是满二叉树
 ReturnData* process(Node* head);
 int question6(Node* head);//如何判断一棵树是平衡二叉树
+ReturnData tree_size_info(Node* head);//整棵树的高度和节点数（用TreeArena::fold，不递归）
+int tree_balanced_height(Node* head);//平衡时返回高度，否则返回-1（用TreeArena::fold，不递归）
+ReturnData process_no_recur(Node* head);//process的指针版本（显式栈后序遍历，不经过TreeArena）
+int question6_no_recur(Node* head);//question6的指针版本（显式栈后序遍历，不经过TreeArena）
 Node* question7(Node* head, Node* node1, Node* node2);//给定两个二叉树节点node1和node2，找到他们的最低公共点
 void process(Node* head, unordered_map<Node*, Node*> &parent);//遍历整棵树，储存父节点
 Node* question7_recur(Node* head, Node* node1, Node* node2);//给定两个二叉树节点node1和node2，找到他们的最低公共点(recursion)
 Node* question8(Node* head, Node* node1);//找到某个节点的后继节点
 string question9(Node* head);//树的序列化
 Node* question9_re(string seq);//树的反序列化
-Node* process9(queue<string> &strings);//递归
 void question10(int n);//折纸问题——将一张纸对折n次，打印折痕
 void process10(int layers, int cur_layers, bool flag);//递归
+void tree_serialize(Node* head, vector<unsigned char>& out);//二进制序列化到缓冲区末尾
+bool tree_serialize_fd(Node* head, int fd);//二进制序列化到文件描述符
+bool tree_deserialize(const unsigned char* data, size_t len, Node*& head);//从一段内存反序列化
+bool tree_deserialize_file(const char* path, Node*& head);//从文件反序列化（mmap）
+void tree_free(Node* head);//释放整棵树
+void benchmark_tree_serialize(size_t n);//比较字符串序列化和二进制序列化
+void benchmark_lca(size_t n, size_t query_num);//比较逐个查询和LcaIndex的最低公共祖先查询
+void benchmark_tree_arena(size_t n);//比较指针树和数组中的树
 
 //先序遍历（递归）
 void preorder(Node* head){
@@ -329,19 +366,9 @@ bool question4(Node* head){
     return true;
 }
 
-//如何判断一棵树是满二叉树
+//如何判断一棵树是满二叉树：先拿到左右子树的高度和节点数，再整合出自己的（树型DP，由TreeArena::fold非递归地完成）
 ReturnData* process(Node* head){
-    if (head == nullptr) {
-        return new ReturnData(0, 0);
-    }
-
-    ReturnData* left = process(head->left);
-    ReturnData* right = process(head->right);
-
-    int height = left->height > right->height ? left->height : right->height;
-    int nodes = left->nodes + right->nodes;
-
-    return new ReturnData(height + 1, nodes + 1);
+    return new ReturnData(tree_size_info(head));
 }
 
 //如何判断一棵树是满二叉树
@@ -354,30 +381,69 @@ bool question5(Node* head){
     cout<<total->height<<endl;
     cout<<total->nodes<<endl;
 
-    return (total->nodes == ((1 << total->height) - 1));
+    bool full = (total->nodes == ((1 << total->height) - 1));
+    delete total;
+    return full;
 }
 
-//如何判断一棵树是平衡二叉树
+//如何判断一棵树是平衡二叉树：左右子树都平衡并且高度差小于2时返回当前树的高度，否则返回-1（树型DP，由TreeArena::fold非递归地完成）
 int question6(Node* head){
-    if (head == nullptr) {
-        return 0;
-    }
-
-    int d_left = question6(head->left);
-    int d_right = question6(head->right);
+    return tree_balanced_height(head);
+}
 
-    if (d_left == -1 || d_right == -1) { // 表示左右树至少有一个不平衡
-        return -1;
-    } else {
-        int max = d_left > d_right ? d_left : d_right;
-        int min = max == d_right ? d_left : d_right;
-        if (max - min >= 2) {
-            return -1;
+//process直接在指针树上的版本：显式的栈做后序遍历，空孩子也入栈，结果栈上左孩子的信息在右孩子下面
+ReturnData process_no_recur(Node* head){
+    vector<pair<Node*, bool>> node_stack(1, make_pair(head, false));//second表示孩子是否已经入栈
+    vector<ReturnData> results;
+    while (!node_stack.empty()) {
+        Node* node = node_stack.back().first;
+        bool expanded = node_stack.back().second;
+        node_stack.pop_back();
+        if (node == nullptr) {
+            results.push_back(ReturnData(0, 0));
+        } else if (!expanded) {
+            node_stack.push_back(make_pair(node, true));
+            node_stack.push_back(make_pair(node->right, false));
+            node_stack.push_back(make_pair(node->left, false));
         } else {
-            return max + 1 ; // 返回当前树的最大高度
+            ReturnData right = results.back();
+            results.pop_back();
+            ReturnData left = results.back();
+            results.pop_back();
+            int height = left.height > right.height ? left.height : right.height;
+            results.push_back(ReturnData(height + 1, left.nodes + right.nodes + 1));
         }
     }
+    return results.back();
+}
 
+//question6直接在指针树上的版本，遍历方式同process_no_recur
+int question6_no_recur(Node* head){
+    vector<pair<Node*, bool>> node_stack(1, make_pair(head, false));
+    vector<int> heights;
+    while (!node_stack.empty()) {
+        Node* node = node_stack.back().first;
+        bool expanded = node_stack.back().second;
+        node_stack.pop_back();
+        if (node == nullptr) {
+            heights.push_back(0);
+        } else if (!expanded) {
+            node_stack.push_back(make_pair(node, true));
+            node_stack.push_back(make_pair(node->right, false));
+            node_stack.push_back(make_pair(node->left, false));
+        } else {
+            int d_right = heights.back();
+            heights.pop_back();
+            int d_left = heights.back();
+            heights.pop_back();
+            if (d_left == -1 || d_right == -1 || abs(d_left - d_right) >= 2) {
+                heights.push_back(-1);
+            } else {
+                heights.push_back((d_left > d_right ? d_left : d_right) + 1);
+            }
+        }
+    }
+    return heights.back();
 }
 
 //给定两个二叉树节点node1和node2，找到他们的最低公共点
@@ -493,7 +559,7 @@ Node* question8(Node* head, Node* node1){
 
 }
 
-//树的序列化
+//树的序列化（先序，"_"分隔，空节点为"#"），原地追加，线性时间
 string question9(Node* head){
     if (head == nullptr) {
         string seq = "#_";
@@ -507,7 +573,8 @@ string question9(Node* head){
         head = node_stack.top();
         node_stack.pop();
         if (head != nullptr) {
-            seq = seq + to_string(head->value) + string("_");
+            seq += to_string(head->value);
+            seq += '_';
             node_stack.push(head->right);
             node_stack.push(head->left);
         } else {
@@ -518,41 +585,25 @@ string question9(Node* head){
     return seq;
 }
 
-//树的反序列化
+//树的反序列化：用下标扫描字符串，栈里放还没填的孩子指针的地址，线性时间、非递归
 Node* question9_re(string seq){
-    queue<string> strings;
-    while (seq.size() != 0) {
-        int index = seq.find("_");
-        strings.push(seq.substr(0, index));
-        seq.erase(0, index+1);
-    }
-//    while (!strings.empty()) {
-//        if (strings.front() != "#") {
-//            cout<<strings.front()<<" ";
-//        }
-//        strings.pop();
-//    }
-    Node* head = process9(strings);
-    return head;
-}
-
-//递归
-Node* process9(queue<string> &strings){
-    if (strings.front() == "#") {
-        strings.pop();
-        return nullptr;
-    }
-    string s = strings.front();
-    strings.pop();
-    int val = atoi(s.c_str());
-    Node* head = new Node(val);
-    Node* left = process9(strings);
-    Node* right = process9(strings);
-    if (left != nullptr) {
-        head->left = left;
-    }
-    if (right != nullptr) {
-        head->right = right;
+    Node* head = nullptr;
+    vector<Node**> pending(1, &head);
+    size_t pos = 0;
+    while (!pending.empty() && pos < seq.size()) {
+        size_t index = seq.find('_', pos);
+        if (index == string::npos) {
+            index = seq.size();
+        }
+        Node** target = pending.back();
+        pending.pop_back();
+        if (seq[pos] != '#') {
+            Node* node = new Node(atoi(seq.c_str() + pos));
+            *target = node;
+            pending.push_back(&node->right);
+            pending.push_back(&node->left);
+        }
+        pos = index + 1;
     }
     return head;
 }
@@ -575,7 +626,1199 @@ void process10(int layers, int cur_layers, bool flag){ //flag false为凹， tru
     process10(layers, cur_layers + 1, true);//右子树的根节点永远是凸的
 }
 
-int main(){
+/*************************二进制的序列化格式*************************
+ * question9用字符串保存先序序列，每个节点都要把整个字符串拷贝一次，问题9的反序列化也要反复erase，都是O(n^2)；
+ * 现在它们改成了线性的，但是每个数仍然要转成十进制字符串，一个节点占好几个字节
+ * 这里换成二进制格式，仍然是带空节点的先序序列（2n + 1个位置）：
+ *      1）开头是4个字节的"BTR1"
+ *      2）之后按64个位置分块，每块先写一个8字节（小端）的掩码，第i位为1表示第i个位置是节点，为0表示空节点，
+ *         再按顺序写这块中各个节点的值：先zigzag（把负数交错映射成正数），再写成varint（每字节7位，最高位表示后面还有），
+ *         绝对值小的数只占1个字节，空节点只占1位
+ *      3）不写节点个数，解码时记录还有几个位置没填，没有位置要填时就结束，所以编码时可以一边遍历一边写出去
+ * 编码用显式的栈做先序遍历，写到一个可增长的缓冲区里，写文件描述符时缓冲区满1MB就写出去一次；
+ * 解码也是迭代的：栈里放的是还没填的孩子指针的地址，直接在传进来的内存上解析，文件用mmap映射进来，不需要复制
+ */
+const char TREE_MAGIC[4] = {'B', 'T', 'R', '1'};
+const size_t TREE_FLUSH_BYTES = 1 << 20;//写文件描述符时，缓冲区超过这么大就写出去
+
+inline uint32_t tree_zigzag(int value){
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+inline int tree_unzigzag(uint32_t code){
+    return (int)(code >> 1) ^ -(int)(code & 1);
+}
+
+inline unsigned char* tree_put_varint(unsigned char* out, uint32_t code){
+    while (code >= 0x80) {
+        *out++ = (unsigned char)(code | 0x80);
+        code >>= 7;
+    }
+    *out++ = (unsigned char)code;
+    return out;
+}
+
+inline bool tree_get_varint(const unsigned char*& in, const unsigned char* end, uint32_t& code){
+    code = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (in == end) {
+            return false;
+        }
+        unsigned char byte = *in++;
+        code |= (uint32_t)(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return shift < 28 || byte < 0x10;//第5个字节只能有4位
+        }
+    }
+    return false;
+}
+
+//释放整棵树（非递归）
+void tree_free(Node* head){
+    vector<Node*> node_stack;
+    if (head != nullptr) {
+        node_stack.push_back(head);
+    }
+    while (!node_stack.empty()) {
+        head = node_stack.back();
+        node_stack.pop_back();
+        if (head->left != nullptr) {
+            node_stack.push_back(head->left);
+        }
+        if (head->right != nullptr) {
+            node_stack.push_back(head->right);
+        }
+        delete head;
+    }
+}
+
+//编码到out的末尾，每写完一块，out超过TREE_FLUSH_BYTES时调用一次flush(out)，flush返回false时停止
+template<typename Flush>
+bool tree_encode(Node* head, vector<unsigned char>& out, Flush flush){
+    out.insert(out.end(), TREE_MAGIC, TREE_MAGIC + 4);
+    unsigned char block[8 + 64 * 5];
+    unsigned char* values = block + 8;
+    uint64_t mask = 0;
+    int slot = 0;
+    vector<Node*> node_stack(1, head);
+    while (!node_stack.empty()) {
+        head = node_stack.back();
+        node_stack.pop_back();
+        if (head != nullptr) {
+            mask |= (uint64_t)1 << slot;
+            values = tree_put_varint(values, tree_zigzag(head->value));
+            node_stack.push_back(head->right);
+            node_stack.push_back(head->left);
+        }
+        if (++slot == 64 || node_stack.empty()) {
+            for (int i = 0; i < 8; i++) {
+                block[i] = (unsigned char)(mask >> (8 * i));
+            }
+            out.insert(out.end(), block, values);
+            values = block + 8;
+            mask = 0;
+            slot = 0;
+            if (out.size() >= TREE_FLUSH_BYTES && !flush(out)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//序列化到缓冲区out的末尾
+void tree_serialize(Node* head, vector<unsigned char>& out){
+    tree_encode(head, out, [](vector<unsigned char>&) { return true; });
+}
+
+//从data开始的len个字节反序列化，数据不完整、有多余的字节或格式不对时返回false，head为nullptr
+bool tree_deserialize(const unsigned char* data, size_t len, Node*& head){
+    head = nullptr;
+    if (len < 4 || memcmp(data, TREE_MAGIC, 4) != 0) {
+        return false;
+    }
+    const unsigned char* in = data + 4;
+    const unsigned char* end = data + len;
+    vector<Node**> pending(1, &head);//还没填的孩子指针，栈顶是先序的下一个位置
+    while (!pending.empty()) {
+        if (end - in < 8) {
+            tree_free(head);
+            head = nullptr;
+            return false;
+        }
+        uint64_t mask = 0;
+        for (int i = 0; i < 8; i++) {
+            mask |= (uint64_t)in[i] << (8 * i);
+        }
+        in += 8;
+        int slot = 0;
+        for (; slot < 64 && !pending.empty(); slot++) {
+            Node** target = pending.back();
+            pending.pop_back();
+            if ((mask >> slot) & 1) {
+                uint32_t code;
+                if (!tree_get_varint(in, end, code)) {
+                    tree_free(head);
+                    head = nullptr;
+                    return false;
+                }
+                Node* node = new Node(tree_unzigzag(code));
+                *target = node;
+                pending.push_back(&node->right);
+                pending.push_back(&node->left);
+            }
+        }
+        if (slot < 64 && (mask >> slot) != 0) {//最后一块中用不到的位置必须是0
+            tree_free(head);
+            head = nullptr;
+            return false;
+        }
+    }
+    if (in != end) {//后面还有多余的字节
+        tree_free(head);
+        head = nullptr;
+        return false;
+    }
+    return true;
+}
+
+//写len个字节到fd，处理部分写入
+bool tree_write_all(int fd, const unsigned char* data, size_t len){
+#if TREE_HAS_MMAP
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+    return true;
+#else
+    (void)fd;
+    (void)data;
+    return len == 0;
+#endif
+}
+
+//一边遍历一边序列化到文件描述符fd
+bool tree_serialize_fd(Node* head, int fd){
+    vector<unsigned char> buffer;
+    buffer.reserve(TREE_FLUSH_BYTES + 8 + 64 * 5);
+    auto flush = [fd](vector<unsigned char>& out) {
+        bool ok = tree_write_all(fd, out.data(), out.size());
+        out.clear();
+        return ok;
+    };
+    return tree_encode(head, buffer, flush) && flush(buffer);
+}
+
+bool tree_serialize_file(Node* head, const char* path){
+#if TREE_HAS_MMAP
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = tree_serialize_fd(head, fd);
+    return close(fd) == 0 && ok;
+#else
+    vector<unsigned char> buffer;
+    tree_serialize(head, buffer);
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    return fclose(file) == 0 && ok;
+#endif
+}
+
+//从文件反序列化，支持mmap时直接在映射的内存上解码
+bool tree_deserialize_file(const char* path, Node*& head){
+    head = nullptr;
+#if TREE_HAS_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    size_t len = (size_t)info.st_size;
+    void* mapped = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return false;
+    }
+    madvise(mapped, len, MADV_SEQUENTIAL);
+    bool ok = tree_deserialize((const unsigned char*)mapped, len, head);
+    munmap(mapped, len);
+    return ok;
+#else
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    vector<unsigned char> data;
+    unsigned char chunk[1 << 16];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + count);
+    }
+    fclose(file);
+    return tree_deserialize(data.data(), data.size(), head);
+#endif
+}
+
+//两棵树的结构和值是否完全相同（非递归）
+bool tree_equal(Node* a, Node* b){
+    vector<pair<Node*, Node*> > node_stack(1, make_pair(a, b));
+    while (!node_stack.empty()) {
+        a = node_stack.back().first;
+        b = node_stack.back().second;
+        node_stack.pop_back();
+        if (a == nullptr || b == nullptr) {
+            if (a != b) {
+                return false;
+            }
+            continue;
+        }
+        if (a->value != b->value) {
+            return false;
+        }
+        node_stack.push_back(make_pair(a->left, b->left));
+        node_stack.push_back(make_pair(a->right, b->right));
+    }
+    return true;
+}
+
+//随机插入n个数得到的搜索二叉树（非递归插入），值有正有负
+Node* random_tree(size_t n, unsigned seed){
+    mt19937 rng(seed);
+    Node* head = nullptr;
+    for (size_t i = 0; i < n; i++) {
+        int value = (int)(rng() % 2000001) - 1000000;
+        Node** slot = &head;
+        while (*slot != nullptr) {
+            slot = value < (*slot)->value ? &(*slot)->left : &(*slot)->right;
+        }
+        *slot = new Node(value);
+    }
+    return head;
+}
+
+//比较字符串序列化（问题9）和二进制序列化
+void benchmark_tree_serialize(size_t n){
+    Node* head = random_tree(n, 11);
+    auto nanos = [](chrono::steady_clock::time_point start) {
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count() * 1e9;
+    };
+    cout<<"nodes = "<<n<<" (ns/node)"<<endl;
+
+    auto start = chrono::steady_clock::now();
+    string seq = question9(head);
+    double encode_time = nanos(start);
+    start = chrono::steady_clock::now();
+    Node* copy = question9_re(seq);
+    double decode_time = nanos(start);
+    cout<<"string: "<<(double)seq.size() / n<<" bytes/node, encode "<<encode_time / n<<", decode "<<decode_time / n
+        <<(tree_equal(head, copy) ? "" : " (wrong)")<<endl;
+    tree_free(copy);
+    string().swap(seq);
+
+    vector<unsigned char> buffer;
+    start = chrono::steady_clock::now();
+    tree_serialize(head, buffer);
+    encode_time = nanos(start);
+    start = chrono::steady_clock::now();
+    bool ok = tree_deserialize(buffer.data(), buffer.size(), copy);
+    decode_time = nanos(start);
+    cout<<"binary: "<<(double)buffer.size() / n<<" bytes/node, encode "<<encode_time / n<<", decode "<<decode_time / n
+        <<" ("<<buffer.size() / (encode_time + 1) * 1e3<<" MB/s encode, "<<buffer.size() / (decode_time + 1) * 1e3<<" MB/s decode)"
+        <<(ok && tree_equal(head, copy) ? "" : " (wrong)")<<endl;
+    tree_free(copy);
+    tree_free(head);
+}
+
+/*************************最低公共祖先的索引*************************
+ * question7每次查询都要遍历整棵树建一张父节点哈希表，question7_recur每次查询也要递归整棵树，查询多的时候太慢
+ * LcaIndex对一棵固定的树只预处理一次：
+ *      1）非递归先序遍历，给节点按先序编号（0是根），记下每个编号的父节点和深度，编号之间的关系都在数组里
+ *      2）u != v并且u的先序编号较小时，在先序编号(u, v]之间深度最小的节点的父节点就是它们的最低公共祖先
+ *         （这是欧拉序加区间最小值的做法，只是用先序代替欧拉序，数组长度从2n - 1变成n）
+ *      3）区间最小值分块求：每32个编号一块，块之间用稀疏表（ST表），块内用单调栈的位掩码，
+ *         mask[i]是块内处理到i时单调栈里的位置，查询[l, r]时把mask[r]中l之前的位去掉，最低的1就是最小值的位置，
+ *         所以查询是O(1)的，额外空间只有每个节点4字节加上n / 32个块的稀疏表
+ *      4）第k个祖先用倍增表（up[j][v]是v的第2^j个祖先），倍增表要每个节点每层4字节，只在需要时调用build_lifting建立，
+ *         没有建立时沿着父节点走k步
+ *      5）离线的Tarjan算法：把所有查询按端点挂在节点上，按先序扫描编号，一个节点的子树扫描完（后序）时回答它上面的查询，
+ *         然后把它并到父节点的集合里，另一个端点已经扫描完时，它所在集合的代表就是答案；用子树的结束编号代替递归
+ * 查询可以用先序编号，也可以用节点指针：指针到编号的哈希表每个节点要40多字节，比上面所有数组加起来还大，
+ * 所以只在第一次用节点指针查询时才建立（call_once，多个线程同时查询也只建一次），只用编号查询时不占这部分空间
+ */
+const uint32_t LCA_NIL = UINT32_MAX;
+const uint32_t LCA_BLOCK = 32;//块内的位置用一个uint32_t的掩码表示
+
+class LcaIndex{
+public:
+    explicit LcaIndex(Node* head){
+        if (head == nullptr) {
+            return;
+        }
+        vector<pair<Node*, uint32_t> > node_stack(1, make_pair(head, LCA_NIL));
+        while (!node_stack.empty()) {
+            Node* node = node_stack.back().first;
+            uint32_t father = node_stack.back().second;
+            node_stack.pop_back();
+            uint32_t id = (uint32_t)nodes.size();
+            nodes.push_back(node);
+            parent.push_back(father);
+            depth.push_back(father == LCA_NIL ? 0 : depth[father] + 1);
+            if (node->right != nullptr) {
+                node_stack.push_back(make_pair(node->right, id));
+            }
+            if (node->left != nullptr) {
+                node_stack.push_back(make_pair(node->left, id));
+            }
+        }
+        uint32_t n = (uint32_t)nodes.size();
+        subtree_end.assign(n, 1);
+        for (uint32_t id = n - 1; id > 0; id--) {//先把子树大小累加到父节点，再换成结束编号
+            subtree_end[parent[id]] += subtree_end[id];
+        }
+        for (uint32_t id = 0; id < n; id++) {
+            subtree_end[id] += id;
+        }
+
+        masks.resize(n);
+        uint32_t blocks = (n + LCA_BLOCK - 1) / LCA_BLOCK;
+        block_table.assign(1, vector<uint32_t>(blocks));
+        for (uint32_t block = 0; block < blocks; block++) {
+            uint32_t start = block * LCA_BLOCK;
+            uint32_t end = min(n, start + LCA_BLOCK);
+            uint32_t stack_mask = 0;
+            for (uint32_t i = start; i < end; i++) {
+                while (stack_mask != 0 && depth[start + 31 - __builtin_clz(stack_mask)] > depth[i]) {
+                    stack_mask ^= 1u << (31 - __builtin_clz(stack_mask));
+                }
+                stack_mask |= 1u << (i - start);
+                masks[i] = stack_mask;
+            }
+            block_table[0][block] = start + __builtin_ctz(masks[end - 1]);
+        }
+        for (uint32_t len = 2; len <= blocks; len *= 2) {
+            const vector<uint32_t>& prev = block_table.back();
+            vector<uint32_t> level(blocks - len + 1);
+            for (uint32_t block = 0; block + len <= blocks; block++) {
+                level[block] = shallower(prev[block], prev[block + len / 2]);
+            }
+            block_table.push_back(level);
+        }
+    }
+
+    size_t size() const { return nodes.size(); }
+    Node* node_of(uint32_t id) const { return id == LCA_NIL ? nullptr : nodes[id]; }
+    uint32_t parent_of(uint32_t id) const { return parent[id]; }
+    uint32_t depth_of(uint32_t id) const { return depth[id]; }
+
+    //节点的先序编号，不在树里时返回LCA_NIL；第一次调用时建立哈希表
+    uint32_t id_of(Node* node) const {
+        call_once(ids_once, [this]() {
+            ids.reserve(nodes.size());
+            for (uint32_t id = 0; id < (uint32_t)nodes.size(); id++) {
+                ids[nodes[id]] = id;
+            }
+        });
+        unordered_map<Node*, uint32_t>::const_iterator it = ids.find(node);
+        return it == ids.end() ? LCA_NIL : it->second;
+    }
+
+    uint32_t lca(uint32_t a, uint32_t b) const {
+        if (a == b) {
+            return a;
+        }
+        if (a > b) {
+            swap(a, b);
+        }
+        return parent[range_min(a + 1, b)];
+    }
+
+    Node* lca(Node* a, Node* b) const {
+        uint32_t id_a = id_of(a);
+        uint32_t id_b = id_of(b);
+        return id_a == LCA_NIL || id_b == LCA_NIL ? nullptr : nodes[lca(id_a, id_b)];
+    }
+
+    //建立倍增表，之后kth_ancestor是O(log k)的
+    void build_lifting(){
+        uint32_t max_depth = 0;
+        for (uint32_t d : depth) {
+            max_depth = max(max_depth, d);
+        }
+        up.assign(1, parent);
+        while ((max_depth >> up.size()) != 0) {
+            const vector<uint32_t>& prev = up.back();
+            vector<uint32_t> level(nodes.size());
+            for (size_t id = 0; id < nodes.size(); id++) {
+                level[id] = prev[id] == LCA_NIL ? LCA_NIL : prev[prev[id]];
+            }
+            up.push_back(level);
+        }
+    }
+
+    //第k个祖先（k为0时是自己），k超过深度时返回LCA_NIL
+    uint32_t kth_ancestor(uint32_t id, uint32_t k) const {
+        if (k > depth[id]) {
+            return LCA_NIL;
+        }
+        if (up.empty()) {
+            while (k-- > 0) {
+                id = parent[id];
+            }
+            return id;
+        }
+        for (uint32_t level = 0; k != 0; level++, k >>= 1) {
+            if (k & 1) {
+                id = up[level][id];
+            }
+        }
+        return id;
+    }
+
+    Node* kth_ancestor(Node* node, uint32_t k) const {
+        uint32_t id = id_of(node);
+        return id == LCA_NIL ? nullptr : node_of(kth_ancestor(id, k));
+    }
+
+    //离线Tarjan：一次回答所有(a, b)查询，answers[i]是第i个查询的最低公共祖先的编号
+    void lca_offline(const vector<pair<uint32_t, uint32_t> >& queries, vector<uint32_t>& answers) const {
+        uint32_t n = (uint32_t)nodes.size();
+        answers.assign(queries.size(), LCA_NIL);
+        vector<uint32_t> offsets(n + 1, 0);//每个节点上挂的查询（CSR）
+        for (const pair<uint32_t, uint32_t>& query : queries) {
+            offsets[query.first + 1]++;
+            offsets[query.second + 1]++;
+        }
+        for (uint32_t id = 0; id < n; id++) {
+            offsets[id + 1] += offsets[id];
+        }
+        vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        vector<uint32_t> attached(2 * queries.size());
+        for (uint32_t i = 0; i < queries.size(); i++) {
+            attached[fill[queries[i].first]++] = i;
+            attached[fill[queries[i].second]++] = i;
+        }
+
+        vector<uint32_t> group(n);//并查集，一个集合的代表就是还没扫描完的那个祖先
+        for (uint32_t id = 0; id < n; id++) {
+            group[id] = id;
+        }
+        vector<bool> finished(n, false);
+        auto find = [&group](uint32_t id) {
+            uint32_t root = id;
+            while (group[root] != root) {
+                root = group[root];
+            }
+            while (group[id] != root) {
+                uint32_t next = group[id];
+                group[id] = root;
+                id = next;
+            }
+            return root;
+        };
+        auto finish = [&](uint32_t id) {
+            finished[id] = true;
+            for (uint32_t k = offsets[id]; k < offsets[id + 1]; k++) {
+                const pair<uint32_t, uint32_t>& query = queries[attached[k]];
+                uint32_t other = query.first == id ? query.second : query.first;
+                if (finished[other]) {
+                    answers[attached[k]] = find(other);
+                }
+            }
+            if (parent[id] != LCA_NIL) {
+                group[id] = parent[id];
+            }
+        };
+        vector<uint32_t> open;//还没扫描完子树的节点
+        for (uint32_t id = 0; id < n; id++) {
+            while (!open.empty() && subtree_end[open.back()] <= id) {
+                finish(open.back());
+                open.pop_back();
+            }
+            open.push_back(id);
+        }
+        while (!open.empty()) {
+            finish(open.back());
+            open.pop_back();
+        }
+    }
+
+private:
+    vector<Node*> nodes;//先序编号到节点
+    vector<uint32_t> parent;
+    vector<uint32_t> depth;
+    vector<uint32_t> subtree_end;//子树中最后一个节点的编号加1
+    vector<uint32_t> masks;//块内单调栈的位掩码
+    vector<vector<uint32_t> > block_table;//block_table[j][b]是第b块开始的2^j块中深度最小的编号
+    vector<vector<uint32_t> > up;//倍增表
+    mutable once_flag ids_once;
+    mutable unordered_map<Node*, uint32_t> ids;//节点指针到编号，id_of第一次调用时才建立
+
+    uint32_t shallower(uint32_t a, uint32_t b) const {
+        return depth[b] < depth[a] ? b : a;
+    }
+
+    //同一块内[l, r]中深度最小的编号
+    uint32_t in_block_min(uint32_t l, uint32_t r) const {
+        return (r & ~(LCA_BLOCK - 1)) + __builtin_ctz(masks[r] & (~0u << (l % LCA_BLOCK)));
+    }
+
+    //[l, r]中深度最小的编号
+    uint32_t range_min(uint32_t l, uint32_t r) const {
+        uint32_t left_block = l / LCA_BLOCK;
+        uint32_t right_block = r / LCA_BLOCK;
+        if (left_block == right_block) {
+            return in_block_min(l, r);
+        }
+        uint32_t best = shallower(in_block_min(l, left_block * LCA_BLOCK + LCA_BLOCK - 1), in_block_min(right_block * LCA_BLOCK, r));
+        if (right_block - left_block > 1) {
+            uint32_t count = right_block - left_block - 1;
+            uint32_t level = 31 - __builtin_clz(count);
+            best = shallower(best, shallower(block_table[level][left_block + 1], block_table[level][right_block - (1u << level)]));
+        }
+        return best;
+    }
+};
+
+//比较question7、question7_recur、LcaIndex的在线查询和离线查询
+void benchmark_lca(size_t n, size_t query_num){
+    Node* head = random_tree(n, 13);
+    auto nanos = [](chrono::steady_clock::time_point start) {
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count() * 1e9;
+    };
+    auto start = chrono::steady_clock::now();
+    LcaIndex index(head);
+    double build_time = nanos(start);
+    n = index.size();
+    mt19937 rng(17);
+    vector<pair<uint32_t, uint32_t> > queries(query_num);
+    for (auto& query : queries) {
+        query = make_pair(1 + (uint32_t)(rng() % (n - 1)), 1 + (uint32_t)(rng() % (n - 1)));//question7不能查询根节点
+    }
+    cout<<"nodes = "<<n<<", queries = "<<query_num<<", build "<<build_time / n<<" ns/node"<<endl;
+
+    size_t slow_num = min<size_t>(query_num, 20);
+    bool same = true;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < slow_num; i++) {
+        Node* a = index.node_of(queries[i].first);
+        Node* b = index.node_of(queries[i].second);
+        same = same && question7(head, a, b) == index.node_of(index.lca(queries[i].first, queries[i].second));
+    }
+    double slow_time = nanos(start);
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < slow_num; i++) {
+        Node* a = index.node_of(queries[i].first);
+        Node* b = index.node_of(queries[i].second);
+        same = same && question7_recur(head, a, b) == index.node_of(index.lca(queries[i].first, queries[i].second));
+    }
+    double recur_time = nanos(start);
+    cout<<"question7 "<<slow_time / slow_num<<" ns/query, question7_recur "<<recur_time / slow_num<<" ns/query"<<(same ? "" : " (wrong)")<<endl;
+
+    vector<uint32_t> online(query_num);
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < query_num; i++) {
+        online[i] = index.lca(queries[i].first, queries[i].second);
+    }
+    double id_time = nanos(start);
+    start = chrono::steady_clock::now();
+    same = same && index.id_of(head) == 0;//第一次用指针查询，建立哈希表
+    double ids_time = nanos(start);
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < query_num; i++) {
+        same = same && index.lca(index.node_of(queries[i].first), index.node_of(queries[i].second)) == index.node_of(online[i]);
+    }
+    double pointer_time = nanos(start);
+    vector<uint32_t> offline;
+    start = chrono::steady_clock::now();
+    index.lca_offline(queries, offline);
+    double offline_time = nanos(start);
+    same = same && offline == online;
+    cout<<"index by id "<<id_time / query_num<<", by pointer "<<pointer_time / query_num<<", offline tarjan "<<offline_time / query_num
+        <<" ns/query, pointer hash table build "<<ids_time / n<<" ns/node"<<(same ? "" : " (wrong)")<<endl;
+
+    start = chrono::steady_clock::now();
+    index.build_lifting();
+    build_time = nanos(start);
+    uint64_t check = 0;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < query_num; i++) {
+        uint32_t id = queries[i].first;
+        check += index.kth_ancestor(id, (uint32_t)(rng() % (index.depth_of(id) + 1)));
+    }
+    double kth_time = nanos(start);
+    cout<<"binary lifting: build "<<build_time / n<<" ns/node, k-th ancestor "<<kth_time / query_num<<" ns/query ("<<check % 10<<")"<<endl;
+    tree_free(head);
+}
+
+/*************************连续数组中的树（下标代替指针）*************************
+ * 上面的树每个节点都是单独new出来的，遍历时每一步都在追指针，而且这些节点从来没有释放过
+ * TreeArena把整棵树放在几个连续的数组里（SoA，值、左孩子、右孩子各一个数组），孩子用32位下标表示，TREE_NIL表示空
+ * 节点在数组中的顺序可以选：
+ *      1）宽度优先顺序（BFS）：同一层的节点相邻，层次遍历就是顺序扫描
+ *      2）van Emde Boas顺序（vEB）：把树从一半高度处切开，先放上半部分，再依次放下面的每一棵子树，每部分内部递归地这样放，
+ *         任意一条从根往下的路径经过的内存块数都很少，不管缓存行有多大
+ * 两种顺序都保证父节点的下标小于孩子的下标，所以从后往前扫描数组就是一个合法的“先孩子后父节点”的顺序，
+ * 求高度、判断平衡二叉树、满二叉树这些树型DP都不需要递归，也不需要栈，只是对数组的一次倒序扫描；
+ * 深度则是一次正序扫描；先序、中序、后序遍历仍然需要一个栈，但栈里放的是下标
+ * 可以从指针树、有序数组（建成平衡的搜索二叉树）、完全二叉树的层次序列批量建立
+ *
+ * process、question6这些“先拿到左右子树的信息，再整合出自己的信息”的递归都是同一个套路，
+ * fold把这个套路写成框架：使用者给出信息的类型Info、空树的信息（basecase）和整合函数combine(index, 左子树信息, 右子树信息)
+ *      1）单线程时就是上面说的倒序扫描
+ *      2）多线程时先求出每棵子树的大小，从根往下拆，把不超过一定大小的子树作为任务，任务按从大到小的顺序分给各个线程，
+ *         每个任务内部用显式的栈做后序遍历；任务都做完以后，再倒序处理上面剩下的那些大子树的根
+ *      3）不递归，所以很深的树（比如一条长链）也不会栈溢出
+ * 判断搜索二叉树、满二叉树、平衡二叉树都是fold的实例，指针树上的process（问题5）和question6也是先复制进TreeArena再用fold求解
+ */
+const uint32_t TREE_NIL = UINT32_MAX;
+const size_t TREE_PARALLEL_MIN = 1 << 16;//节点数少于这个时只用一个线程
+
+enum TreeLayout {
+    TREE_LAYOUT_BFS,
+    TREE_LAYOUT_VEB
+};
+
+class TreeArena{
+public:
+    TreeArena() : root(TREE_NIL) {}
+
+    size_t size() const { return values.size(); }
+    bool empty() const { return values.empty(); }
+    uint32_t root_index() const { return root; }
+    int value_of(uint32_t index) const { return values[index]; }
+    uint32_t left_of(uint32_t index) const { return left[index]; }
+    uint32_t right_of(uint32_t index) const { return right[index]; }
+
+    //从指针树建立
+    static TreeArena from_tree(Node* head, TreeLayout layout = TREE_LAYOUT_BFS){
+        TreeArena tree;
+        if (head == nullptr) {
+            return tree;
+        }
+        vector<Node*> order(1, head);//宽度优先顺序
+        for (size_t i = 0; i < order.size(); i++) {
+            if (order[i]->left != nullptr) {
+                order.push_back(order[i]->left);
+            }
+            if (order[i]->right != nullptr) {
+                order.push_back(order[i]->right);
+            }
+        }
+        tree.resize(order.size());
+        tree.root = 0;
+        uint32_t next = 1;
+        for (size_t i = 0; i < order.size(); i++) {
+            tree.values[i] = order[i]->value;
+            tree.left[i] = order[i]->left != nullptr ? next++ : TREE_NIL;
+            tree.right[i] = order[i]->right != nullptr ? next++ : TREE_NIL;
+        }
+        return layout == TREE_LAYOUT_BFS ? tree : tree.relayout(layout);
+    }
+
+    //有序数组建成平衡的搜索二叉树：按宽度优先的顺序依次处理每个区间，区间的中点就是这个节点
+    static TreeArena from_sorted(const int* data, size_t len, TreeLayout layout = TREE_LAYOUT_BFS){
+        TreeArena tree;
+        if (len == 0) {
+            return tree;
+        }
+        tree.resize(len);
+        tree.root = 0;
+        vector<pair<size_t, size_t> > ranges(1, make_pair((size_t)0, len));//第i个节点负责的区间[first, second)
+        uint32_t next = 1;
+        for (size_t i = 0; i < len; i++) {
+            size_t begin = ranges[i].first;
+            size_t end = ranges[i].second;
+            size_t mid = begin + (end - begin) / 2;
+            tree.values[i] = data[mid];
+            tree.left[i] = TREE_NIL;
+            tree.right[i] = TREE_NIL;
+            if (begin < mid) {
+                tree.left[i] = next++;
+                ranges.push_back(make_pair(begin, mid));
+            }
+            if (mid + 1 < end) {
+                tree.right[i] = next++;
+                ranges.push_back(make_pair(mid + 1, end));
+            }
+        }
+        return layout == TREE_LAYOUT_BFS ? tree : tree.relayout(layout);
+    }
+
+    //完全二叉树的层次序列（第i个节点的孩子是2i + 1和2i + 2）
+    static TreeArena from_complete(const int* data, size_t len, TreeLayout layout = TREE_LAYOUT_BFS){
+        TreeArena tree;
+        if (len == 0) {
+            return tree;
+        }
+        tree.resize(len);
+        tree.root = 0;
+        for (size_t i = 0; i < len; i++) {
+            tree.values[i] = data[i];
+            tree.left[i] = 2 * i + 1 < len ? (uint32_t)(2 * i + 1) : TREE_NIL;
+            tree.right[i] = 2 * i + 2 < len ? (uint32_t)(2 * i + 2) : TREE_NIL;
+        }
+        return layout == TREE_LAYOUT_BFS ? tree : tree.relayout(layout);
+    }
+
+    //按另一种顺序重新排列节点
+    TreeArena relayout(TreeLayout layout) const {
+        vector<uint32_t> order;//新的第i个节点是原来的order[i]
+        order.reserve(size());
+        if (root != TREE_NIL) {
+            if (layout == TREE_LAYOUT_BFS) {
+                order.push_back(root);
+                for (size_t i = 0; i < order.size(); i++) {
+                    push_children(order[i], order);
+                }
+            } else {
+                veb_order(root, height(), order);
+            }
+        }
+        vector<uint32_t> rank(size());
+        for (uint32_t i = 0; i < order.size(); i++) {
+            rank[order[i]] = i;
+        }
+        TreeArena tree;
+        tree.resize(order.size());
+        tree.root = order.empty() ? TREE_NIL : 0;
+        for (size_t i = 0; i < order.size(); i++) {
+            uint32_t old = order[i];
+            tree.values[i] = values[old];
+            tree.left[i] = left[old] == TREE_NIL ? TREE_NIL : rank[left[old]];
+            tree.right[i] = right[old] == TREE_NIL ? TREE_NIL : rank[right[old]];
+        }
+        return tree;
+    }
+
+    //转回指针树（用tree_free释放）
+    Node* to_tree() const {
+        vector<Node*> nodes(size());
+        for (size_t i = size(); i-- > 0;) {//孩子的下标更大，先建
+            nodes[i] = new Node(values[i]);
+            nodes[i]->left = left[i] == TREE_NIL ? nullptr : nodes[left[i]];
+            nodes[i]->right = right[i] == TREE_NIL ? nullptr : nodes[right[i]];
+        }
+        return root == TREE_NIL ? nullptr : nodes[root];
+    }
+
+    //先序遍历（非递归），对每个节点的下标调用visit
+    template<typename F>
+    void preorder(F visit) const {
+        vector<uint32_t> index_stack;
+        if (root != TREE_NIL) {
+            index_stack.push_back(root);
+        }
+        while (!index_stack.empty()) {
+            uint32_t index = index_stack.back();
+            index_stack.pop_back();
+            visit(index);
+            if (right[index] != TREE_NIL) {
+                index_stack.push_back(right[index]);
+            }
+            if (left[index] != TREE_NIL) {
+                index_stack.push_back(left[index]);
+            }
+        }
+    }
+
+    //中序遍历（非递归）
+    template<typename F>
+    void inorder(F visit) const {
+        vector<uint32_t> index_stack;
+        uint32_t index = root;
+        while (index != TREE_NIL || !index_stack.empty()) {
+            if (index != TREE_NIL) {
+                index_stack.push_back(index);
+                index = left[index];
+            } else {
+                index = index_stack.back();
+                index_stack.pop_back();
+                visit(index);
+                index = right[index];
+            }
+        }
+    }
+
+    //后序遍历（非递归）：按“根、右、左”的顺序入栈，倒过来就是后序
+    template<typename F>
+    void postorder(F visit) const {
+        vector<uint32_t> reversed;
+        reversed.reserve(size());
+        vector<uint32_t> index_stack;
+        if (root != TREE_NIL) {
+            index_stack.push_back(root);
+        }
+        while (!index_stack.empty()) {
+            uint32_t index = index_stack.back();
+            index_stack.pop_back();
+            reversed.push_back(index);
+            if (left[index] != TREE_NIL) {
+                index_stack.push_back(left[index]);
+            }
+            if (right[index] != TREE_NIL) {
+                index_stack.push_back(right[index]);
+            }
+        }
+        for (size_t i = reversed.size(); i-- > 0;) {
+            visit(reversed[i]);
+        }
+    }
+
+    //宽度优先遍历（层次遍历）
+    template<typename F>
+    void level_order(F visit) const {
+        vector<uint32_t> order;
+        order.reserve(size());
+        if (root != TREE_NIL) {
+            order.push_back(root);
+        }
+        for (size_t i = 0; i < order.size(); i++) {
+            visit(order[i]);
+            push_children(order[i], order);
+        }
+    }
+
+    //每个节点的深度（根为0），正序扫描
+    vector<uint32_t> depths() const {
+        vector<uint32_t> depth(size(), 0);
+        for (size_t i = 0; i < size(); i++) {
+            if (left[i] != TREE_NIL) {
+                depth[left[i]] = depth[i] + 1;
+            }
+            if (right[i] != TREE_NIL) {
+                depth[right[i]] = depth[i] + 1;
+            }
+        }
+        return depth;
+    }
+
+    //每个节点为根的子树的高度（叶子为1），倒序扫描
+    vector<uint32_t> heights() const {
+        vector<uint32_t> height(size(), 1);
+        for (size_t i = size(); i-- > 0;) {
+            uint32_t h_left = left[i] == TREE_NIL ? 0 : height[left[i]];
+            uint32_t h_right = right[i] == TREE_NIL ? 0 : height[right[i]];
+            height[i] = max(h_left, h_right) + 1;
+        }
+        return height;
+    }
+
+    uint32_t height() const {
+        return root == TREE_NIL ? 0 : heights()[root];
+    }
+
+    //最大宽度（问题1、2）：每一层的节点数中的最大值
+    size_t max_width() const {
+        vector<uint32_t> depth = depths();
+        vector<size_t> count;
+        for (uint32_t d : depth) {
+            if (d >= count.size()) {
+                count.resize(d + 1, 0);
+            }
+            count[d]++;
+        }
+        return count.empty() ? 0 : *max_element(count.begin(), count.end());
+    }
+
+    //搜索二叉树（问题3）：左子树的最大值 <= 根 <= 右子树的最小值（即中序遍历不下降），空树也算
+    bool is_bst(unsigned thread_num = 1) const {
+        struct BstInfo {
+            bool empty;
+            bool bst;
+            int min;
+            int max;
+        };
+        BstInfo result = fold(BstInfo{true, true, 0, 0}, [this](uint32_t index, const BstInfo& left_info, const BstInfo& right_info) {
+            int value = values[index];
+            bool bst = left_info.bst && right_info.bst && (left_info.empty || left_info.max <= value) && (right_info.empty || value <= right_info.min);
+            return BstInfo{false, bst, left_info.empty ? value : left_info.min, right_info.empty ? value : right_info.max};
+        }, thread_num);
+        return result.bst;
+    }
+
+    //完全二叉树（问题4）：宽度优先遍历中，遇到孩子不双全的节点以后，后面的节点都必须是叶子
+    bool is_complete() const {
+        bool leaf_only = false;
+        bool ok = true;
+        level_order([&](uint32_t index) {
+            bool has_left = left[index] != TREE_NIL;
+            bool has_right = right[index] != TREE_NIL;
+            if ((!has_left && has_right) || (leaf_only && (has_left || has_right))) {
+                ok = false;
+            }
+            if (!has_left || !has_right) {
+                leaf_only = true;
+            }
+        });
+        return ok;
+    }
+
+    //整棵树的高度和节点数（问题5中的process）
+    ReturnData size_info(unsigned thread_num = 1) const {
+        return fold(ReturnData(0, 0), [](uint32_t, const ReturnData& left_info, const ReturnData& right_info) {
+            return ReturnData(max(left_info.height, right_info.height) + 1, left_info.nodes + right_info.nodes + 1);
+        }, thread_num);
+    }
+
+    //满二叉树（问题5）：节点数等于2^高度 - 1
+    bool is_full(unsigned thread_num = 1) const {
+        ReturnData total = size_info(thread_num);
+        return total.height < 31 && total.nodes == (1 << total.height) - 1;
+    }
+
+    //问题6：平衡时返回高度，否则返回-1（和question6的返回值相同）
+    int balanced_height(unsigned thread_num = 1) const {
+        struct BalanceInfo {
+            int height;
+            bool balanced;
+        };
+        BalanceInfo result = fold(BalanceInfo{0, true}, [](uint32_t, const BalanceInfo& left_info, const BalanceInfo& right_info) {
+            bool balanced = left_info.balanced && right_info.balanced && abs(left_info.height - right_info.height) <= 1;
+            return BalanceInfo{max(left_info.height, right_info.height) + 1, balanced};
+        }, thread_num);
+        return result.balanced ? result.height : -1;
+    }
+
+    //平衡二叉树（问题6）：每个节点左右子树的高度差不超过1
+    bool is_balanced(unsigned thread_num = 1) const {
+        return balanced_height(thread_num) != -1;
+    }
+
+    //树型DP：empty是空树的信息，combine(index, left_info, right_info)返回以index为根的子树的信息，
+    //thread_num为0时使用全部核，多线程时combine会被同时调用，不能修改共享的状态
+    template<typename Info, typename Combine>
+    Info fold(const Info& empty, Combine combine, unsigned thread_num = 1) const {
+        static_assert(!is_same<Info, bool>::value, "vector<bool> cannot be written from several threads");
+        if (root == TREE_NIL) {
+            return empty;
+        }
+        vector<Info> info(size(), empty);
+        if (thread_num == 0) {
+            thread_num = max(thread::hardware_concurrency(), 1u);
+        }
+        if (thread_num == 1 || size() < TREE_PARALLEL_MIN) {
+            for (size_t i = size(); i-- > 0;) {
+                combine_at((uint32_t)i, info, empty, combine);
+            }
+            return info[root];
+        }
+
+        vector<uint32_t> sizes(size(), 1);
+        for (size_t i = size(); i-- > 0;) {
+            sizes[i] += (left[i] == TREE_NIL ? 0 : sizes[left[i]]) + (right[i] == TREE_NIL ? 0 : sizes[right[i]]);
+        }
+        size_t grain = max<size_t>(TREE_PARALLEL_MIN / 4, size() / (thread_num * 8));
+        vector<uint32_t> tasks;//不超过grain个节点的子树
+        vector<uint32_t> top;//剩下的大子树的根，父节点在孩子前面
+        vector<uint32_t> index_stack(1, root);
+        while (!index_stack.empty()) {
+            uint32_t index = index_stack.back();
+            index_stack.pop_back();
+            if (sizes[index] <= grain) {
+                tasks.push_back(index);
+                continue;
+            }
+            top.push_back(index);
+            if (left[index] != TREE_NIL) {
+                index_stack.push_back(left[index]);
+            }
+            if (right[index] != TREE_NIL) {
+                index_stack.push_back(right[index]);
+            }
+        }
+        sort(tasks.begin(), tasks.end(), [&sizes](uint32_t a, uint32_t b) { return sizes[a] > sizes[b]; });
+        atomic<size_t> next_task(0);
+        auto worker = [&]() {
+            size_t k;
+            while ((k = next_task++) < tasks.size()) {
+                fold_subtree(tasks[k], info, empty, combine);
+            }
+        };
+        vector<thread> workers;
+        for (unsigned t = 1; t < thread_num && t < tasks.size(); t++) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (thread& w : workers) {
+            w.join();
+        }
+        for (size_t k = top.size(); k-- > 0;) {
+            combine_at(top[k], info, empty, combine);
+        }
+        return info[root];
+    }
+
+private:
+    vector<int> values;
+    vector<uint32_t> left;
+    vector<uint32_t> right;
+    uint32_t root;
+
+    void resize(size_t n){
+        if (n >= TREE_NIL) {
+            throw length_error("TreeArena: too many nodes for 32-bit indices");
+        }
+        values.resize(n);
+        left.resize(n);
+        right.resize(n);
+    }
+
+    template<typename Info, typename Combine>
+    void combine_at(uint32_t index, vector<Info>& info, const Info& empty, const Combine& combine) const {
+        info[index] = combine(index, left[index] == TREE_NIL ? empty : info[left[index]], right[index] == TREE_NIL ? empty : info[right[index]]);
+    }
+
+    //以start为根的子树，用显式的栈做后序遍历
+    template<typename Info, typename Combine>
+    void fold_subtree(uint32_t start, vector<Info>& info, const Info& empty, const Combine& combine) const {
+        vector<pair<uint32_t, bool> > index_stack(1, make_pair(start, false));//second表示孩子是否已经入栈
+        while (!index_stack.empty()) {
+            uint32_t index = index_stack.back().first;
+            if (index_stack.back().second) {
+                index_stack.pop_back();
+                combine_at(index, info, empty, combine);
+                continue;
+            }
+            index_stack.back().second = true;
+            if (right[index] != TREE_NIL) {
+                index_stack.push_back(make_pair(right[index], false));
+            }
+            if (left[index] != TREE_NIL) {
+                index_stack.push_back(make_pair(left[index], false));
+            }
+        }
+    }
+
+    void push_children(uint32_t index, vector<uint32_t>& order) const {
+        if (left[index] != TREE_NIL) {
+            order.push_back(left[index]);
+        }
+        if (right[index] != TREE_NIL) {
+            order.push_back(right[index]);
+        }
+    }
+
+    //以index为根、只看levels层的部分按vEB顺序追加到order：先放上面levels / 2层，再依次放下面的每一棵子树
+    void veb_order(uint32_t index, uint32_t levels, vector<uint32_t>& order) const {
+        if (levels == 1) {
+            order.push_back(index);
+            return;
+        }
+        uint32_t top = levels / 2;
+        veb_order(index, top, order);
+        vector<uint32_t> frontier(1, index);//上半部分最后一层的下一层，从左到右
+        for (uint32_t level = 0; level < top; level++) {
+            vector<uint32_t> next;
+            for (uint32_t node : frontier) {
+                push_children(node, next);
+            }
+            frontier.swap(next);
+        }
+        for (uint32_t node : frontier) {
+            veb_order(node, levels - top, order);
+        }
+    }
+};
+
+ReturnData tree_size_info(Node* head){
+    return TreeArena::from_tree(head).size_info();
+}
+
+int tree_balanced_height(Node* head){
+    return TreeArena::from_tree(head).balanced_height();
+}
+
+//比较指针树和TreeArena（BFS、vEB顺序）上的遍历和各种判断
+void benchmark_tree_arena(size_t n){
+    Node* head = random_tree(n, 19);
+    auto nanos = [](chrono::steady_clock::time_point start) {
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count() * 1e9;
+    };
+    cout<<"nodes = "<<n<<" (ns/node)"<<endl;
+
+    long long sum = 0;
+    auto start = chrono::steady_clock::now();
+    vector<Node*> node_stack(1, head);
+    while (!node_stack.empty()) {
+        Node* node = node_stack.back();
+        node_stack.pop_back();
+        sum += node->value;
+        if (node->right != nullptr) {
+            node_stack.push_back(node->right);
+        }
+        if (node->left != nullptr) {
+            node_stack.push_back(node->left);
+        }
+    }
+    double traverse_time = nanos(start);
+    start = chrono::steady_clock::now();
+    bool checks[4];
+    checks[0] = question3(head);
+    checks[1] = question4(head);
+    ReturnData total = process_no_recur(head);
+    checks[2] = total.height < 31 && total.nodes == (1 << total.height) - 1;
+    checks[3] = question6_no_recur(head) != -1;
+    double check_time = nanos(start);
+    start = chrono::steady_clock::now();
+    ReturnData* copied = process(head);//process和question6先复制进TreeArena再fold
+    bool copied_ok = copied->height == total.height && copied->nodes == total.nodes && (question6(head) != -1) == checks[3];
+    delete copied;
+    double copied_time = nanos(start);
+    cout<<"pointer: preorder "<<traverse_time / n<<", bst+complete+full+balanced "<<check_time / n
+        <<", process+question6 via arena "<<copied_time / n<<(copied_ok ? "" : " (wrong)")<<endl;
+
+    const char* names[2] = {"bfs", "veb"};
+    TreeLayout layouts[2] = {TREE_LAYOUT_BFS, TREE_LAYOUT_VEB};
+    for (int k = 0; k < 2; k++) {
+        start = chrono::steady_clock::now();
+        TreeArena tree = TreeArena::from_tree(head, layouts[k]);
+        double build_time = nanos(start);
+        long long arena_sum = 0;
+        start = chrono::steady_clock::now();
+        tree.preorder([&](uint32_t index) { arena_sum += tree.value_of(index); });
+        traverse_time = nanos(start);
+        start = chrono::steady_clock::now();
+        bool same = tree.is_bst() == checks[0] && tree.is_complete() == checks[1] && tree.is_full() == checks[2] && tree.is_balanced() == checks[3];
+        check_time = nanos(start);
+        start = chrono::steady_clock::now();
+        same = same && tree.is_bst(0) == checks[0] && tree.is_full(0) == checks[2] && tree.is_balanced(0) == checks[3];
+        double parallel_time = nanos(start);
+        cout<<"arena "<<names[k]<<": build "<<build_time / n<<", preorder "<<traverse_time / n<<", bst+complete+full+balanced "<<check_time / n
+            <<", parallel bst+full+balanced "<<parallel_time / n<<(same && sum == arena_sum ? "" : " (wrong)")<<endl;
+    }
+    tree_free(head);
+}
+
+int main(int argc, char* argv[]){
+    if (argc > 1 && string(argv[1]) == "bench") {
+        benchmark_tree_serialize(argc > 2 ? (size_t)atoll(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "bench-arena") {
+        benchmark_tree_arena(argc > 2 ? (size_t)atoll(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "bench-lca") {
+        benchmark_lca(argc > 2 ? (size_t)atoll(argv[2]) : 1000000, argc > 3 ? (size_t)atoll(argv[3]) : 1000000);
+        return 0;
+    }
+
     Node head = Node(4);
     Node two = Node(2);
     Node three = Node(6);
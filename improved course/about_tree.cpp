@@ -11,7 +11,8 @@
  * 用树型DP解两个问题
  * Morris遍历的代码实现、以及用其实现前序、中序、后序
  * 用Morris遍历判断是否是搜索二叉树
- * 最近修改日期：2023-06-28
+ * 放在连续数组中、用下标连接的树，以及树型DP的框架（非递归、大的子树分给多个线程），最大距离和派对的最大快乐值作为它的实例
+ * 最近修改日期：2026-10-18
  *
  * @author   Zhou Junping
  * @email    zhoujunpingnn@gmail.com
@@ -52,6 +53,16 @@
 
 #include <iostream>
 #include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <type_traits>
 
 using namespace std;
 
@@ -74,6 +85,145 @@ struct Stuff {
     }
 };
 
+/**
+ * 放在连续数组中的树
+ * 节点按宽度优先的顺序放在数组里，这样每个节点的孩子在数组中是连续的一段：
+ * 第i个节点的孩子是[child_begin[i], child_begin[i + 1])，二叉树（Node）和多叉树（Stuff）都可以这样存，空孩子不占位置
+ * 父节点的下标总是小于孩子的下标，所以从后往前扫描数组时，处理到一个节点时它的所有子树都已经处理完了
+ *
+ * 树型DP的框架fold和basic course/tree.cpp中的TreeArena::fold相同（做法见那里的说明），
+ * 只是combine拿到的是孩子信息的数组combine(index, children, count)，孩子个数为0时就是basecase
+ * 最大距离（MaxDistance）和派对的最大快乐值（Party）都用fold求解
+ */
+const size_t TREE_PARALLEL_MIN = 1 << 16;  // 节点数少于这个时只用一个线程
+
+class TreeArena {
+public:
+    std::vector<int> values;
+    std::vector<uint32_t> child_begin;  // 第i个节点的孩子是[child_begin[i], child_begin[i + 1])
+
+    // 按宽度优先的顺序把二叉树复制进来，根节点的下标是0
+    explicit TreeArena(Node* head) {
+        build(head, [](Node* node, vector<Node*>& order) {
+            if (node->left != nullptr) order.push_back(node->left);
+            if (node->right != nullptr) order.push_back(node->right);
+        });
+    }
+
+    // 按宽度优先的顺序把员工的树复制进来，快乐值就是values
+    explicit TreeArena(Stuff* boss) {
+        build(boss, [](Stuff* stuff, vector<Stuff*>& order) {
+            order.insert(order.end(), stuff->sub.begin(), stuff->sub.end());
+        });
+    }
+
+    size_t size() const { return values.size(); }
+
+    // 树型DP，返回根节点的信息；thread_num为0时使用全部核，多线程时combine会被同时调用，不能修改共享的状态
+    template<typename Info, typename Combine>
+    Info fold(Combine combine, unsigned thread_num = 1) const {
+        static_assert(!is_same<Info, bool>::value, "vector<bool> cannot be written from several threads");
+        vector<Info> info(size());
+        if (thread_num == 0) {
+            thread_num = max(thread::hardware_concurrency(), 1u);
+        }
+        if (thread_num == 1 || size() < TREE_PARALLEL_MIN) {
+            for (size_t i = size(); i-- > 0;) {
+                combine_at((uint32_t)i, info, combine);
+            }
+            return info[0];
+        }
+
+        vector<uint32_t> sizes(size(), 1);
+        for (size_t i = size(); i-- > 0;) {
+            for (uint32_t child = child_begin[i]; child < child_begin[i + 1]; child++) {
+                sizes[i] += sizes[child];
+            }
+        }
+        size_t grain = max<size_t>(TREE_PARALLEL_MIN / 4, size() / (thread_num * 8));
+        vector<uint32_t> tasks;  // 不超过grain个节点的子树
+        vector<uint32_t> top;  // 剩下的大子树的根，父节点在孩子前面
+        vector<uint32_t> index_stack(1, 0);
+        while (!index_stack.empty()) {
+            uint32_t index = index_stack.back();
+            index_stack.pop_back();
+            if (sizes[index] <= grain) {
+                tasks.push_back(index);
+                continue;
+            }
+            top.push_back(index);
+            for (uint32_t child = child_begin[index]; child < child_begin[index + 1]; child++) {
+                index_stack.push_back(child);
+            }
+        }
+        sort(tasks.begin(), tasks.end(), [&sizes](uint32_t a, uint32_t b) { return sizes[a] > sizes[b]; });
+        atomic<size_t> next_task(0);
+        auto worker = [&]() {
+            size_t k;
+            while ((k = next_task++) < tasks.size()) {
+                fold_subtree(tasks[k], info, combine);
+            }
+        };
+        vector<thread> workers;
+        for (unsigned t = 1; t < thread_num && t < tasks.size(); t++) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (thread& w : workers) {
+            w.join();
+        }
+        for (size_t k = top.size(); k-- > 0;) {
+            combine_at(top[k], info, combine);
+        }
+        return info[0];
+    }
+
+private:
+    template<typename T, typename Children>
+    void build(T* head, Children children) {
+        if (head == nullptr) {
+            return;
+        }
+        vector<T*> order(1, head);
+        child_begin.push_back(1);
+        for (size_t i = 0; i < order.size(); i++) {
+            children(order[i], order);
+            child_begin.push_back((uint32_t)order.size());
+        }
+        values.resize(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            values[i] = node_value(order[i]);
+        }
+    }
+
+    static int node_value(Node* node) { return node->value; }
+    static int node_value(Stuff* stuff) { return stuff->happy; }
+
+    template<typename Info, typename Combine>
+    void combine_at(uint32_t index, vector<Info>& info, const Combine& combine) const {
+        uint32_t begin = child_begin[index];
+        info[index] = combine(index, info.data() + begin, (size_t)(child_begin[index + 1] - begin));
+    }
+
+    // 以start为根的子树，用显式的栈做后序遍历
+    template<typename Info, typename Combine>
+    void fold_subtree(uint32_t start, vector<Info>& info, const Combine& combine) const {
+        vector<pair<uint32_t, bool> > index_stack(1, make_pair(start, false));  // second表示孩子是否已经入栈
+        while (!index_stack.empty()) {
+            uint32_t index = index_stack.back().first;
+            if (index_stack.back().second) {
+                index_stack.pop_back();
+                combine_at(index, info, combine);
+                continue;
+            }
+            index_stack.back().second = true;
+            for (uint32_t child = child_begin[index]; child < child_begin[index + 1]; child++) {
+                index_stack.push_back(make_pair(child, false));
+            }
+        }
+    }
+};
+
 /**
  * 求一颗二叉树的任意两节点之间的最大距离
  * 分两类，1.最大距离的路径通过头节点，2.最大距离的路径不通过头节点
@@ -85,30 +235,74 @@ struct Stuff {
 class MaxDistance {
 private:
     Node* root;
+    const TreeArena* arena = nullptr;
     // 需要返回的返回值类型
     struct Info {
         int max_distance;
         int height;
-        Info(const int & m, const int & h) : max_distance(m), height(h) {}
+        Info(const int & m = 0, const int & h = 0) : max_distance(m), height(h) {}
     };
 public:
     explicit MaxDistance(Node* head) : root(head) {}  // 防止隐式转换
+    explicit MaxDistance(const TreeArena& tree) : root(nullptr), arena(&tree) {}
 
-    int get_max_distance() {
-        Info result = process(root);
-        return result.max_distance;
+    // 指针树先按宽度优先复制进TreeArena，再用fold求解，不递归，很深的树也不会栈溢出
+    int get_max_distance(unsigned thread_num = 1) {
+        if (arena != nullptr) {
+            return process(*arena, thread_num);
+        }
+        return process(TreeArena(root), thread_num);
     }
 
-    Info process(Node* node) {
-        if (node == nullptr) {
-            return {0, 0};  // 叶子节点的最大距离和高度都是0
+    // 直接在指针树上用显式的栈做后序遍历，不经过TreeArena，benchmark拿它作对照
+    int get_max_distance_no_recur() {
+        vector<pair<Node*, bool> > node_stack(1, make_pair(root, false));  // second表示孩子是否已经入栈
+        vector<Info> results;  // 已经算好的子树的信息，左孩子在右孩子下面
+        while (!node_stack.empty()) {
+            Node* node = node_stack.back().first;
+            bool expanded = node_stack.back().second;
+            node_stack.pop_back();
+            if (node == nullptr) {
+                results.push_back(Info(0, 0));  // 空树的最大距离和高度都是0
+            } else if (!expanded) {
+                node_stack.push_back(make_pair(node, true));
+                node_stack.push_back(make_pair(node->right, false));
+                node_stack.push_back(make_pair(node->left, false));
+            } else {
+                Info right = results.back();
+                results.pop_back();
+                Info left = results.back();
+                results.pop_back();
+                int max_distance = max(right.height + left.height + 1, max(right.max_distance, left.max_distance));
+                results.push_back(Info(max_distance, max(right.height, left.height) + 1));
+            }
         }
+        return results.back().max_distance;
+    }
 
-        Info right = process(node->right);  // 计算右子树
-        Info left = process(node->left);  // 计算左子树
-        int max_distance = max(right.height + left.height + 1, max(right.max_distance, left.max_distance));  // 将左右子树的结果和通过当前节点的结果作对比
-        int height = max(right.height, left.height) + 1;  // 当前节点为根节点的树的高度为左右子树中较大的高度+1
-        return {max_distance, height};
+    // 树型DP：空孩子不在数组里，高度按0算；孩子可以多于两个（例如由Stuff建立的树），这时取最高的两个孩子
+    int process(const TreeArena& tree, unsigned thread_num) {
+        if (tree.size() == 0) {
+            return 0;
+        }
+        Info result = tree.fold<Info>([](uint32_t, const Info* children, size_t count) {
+            int first = 0;  // 最高的孩子的高度
+            int second = 0;  // 第二高的孩子的高度
+            int max_distance = 0;
+            for (size_t i = 0; i < count; i++) {
+                int height = children[i].height;
+                if (height > first) {
+                    second = first;
+                    first = height;
+                } else if (height > second) {
+                    second = height;
+                }
+                max_distance = max(max_distance, children[i].max_distance);
+            }
+            // 将子树的结果和通过当前节点的结果作对比，当前节点为根节点的树的高度为孩子中最大的高度+1
+            return Info(max(first + second + 1, max_distance), first + 1);
+        }, thread_num);
+        return result.max_distance;
     }
 };
 
@@ -125,29 +319,59 @@ private:
     struct Info {
         int present_happy;  // 头节点参加派对的快乐值
         int absent_happy;  // 头节点不参加派对的快乐值
-        Info(const int & p, const int & a) : present_happy(p), absent_happy(a) {}
+        Info(const int & p = 0, const int & a = 0) : present_happy(p), absent_happy(a) {}
     };
 
 public:
-    int get_max_happy(Stuff* boss) {
-        Info happy = process(boss);
-        return max(happy.present_happy, happy.absent_happy);
+    // 员工树先按宽度优先复制进TreeArena，再用fold求解
+    int get_max_happy(Stuff* boss, unsigned thread_num = 1) {
+        return get_max_happy(TreeArena(boss), thread_num);
     }
 
-    Info process(Stuff* stuff) {
-        if (stuff->sub.empty()) {  // 当stuff没有员工列表时，说明是底层员工，来快乐值就是自己的快乐值，不来的快乐值就是0
-           return {stuff->happy, 0};
+    // 直接在员工树上用显式的栈做后序遍历，不经过TreeArena，benchmark拿它作对照
+    int get_max_happy_no_recur(Stuff* boss) {
+        if (boss == nullptr) {
+            return 0;
         }
-
-        int present_happy = stuff->happy;  // 当stuff来的时候，快乐值初始为stuff的快乐值
-        int absent_happy = 0;  // 当stuff不来的时候，快乐值初始为0
-        for (auto next : stuff->sub) {
-            Info sub = process(next);
-            present_happy += sub.absent_happy;  // stuff来时，只需要加上下级员工不来时的最大值
-            absent_happy += max(sub.present_happy, sub.absent_happy);  // stuff不来时，需要加上下级员工来与不来之间的最大值
+        vector<pair<Stuff*, bool> > stuff_stack(1, make_pair(boss, false));  // second表示下级是否已经入栈
+        vector<Info> results;  // 已经算好的下级的信息
+        while (!stuff_stack.empty()) {
+            Stuff* stuff = stuff_stack.back().first;
+            if (!stuff_stack.back().second) {
+                stuff_stack.back().second = true;
+                for (auto next : stuff->sub) {
+                    stuff_stack.push_back(make_pair(next, false));
+                }
+                continue;
+            }
+            stuff_stack.pop_back();
+            int present_happy = stuff->happy;
+            int absent_happy = 0;
+            for (size_t i = results.size() - stuff->sub.size(); i < results.size(); i++) {  // 下级的信息在栈顶
+                present_happy += results[i].absent_happy;
+                absent_happy += max(results[i].present_happy, results[i].absent_happy);
+            }
+            results.resize(results.size() - stuff->sub.size());
+            results.push_back(Info(present_happy, absent_happy));
         }
+        return max(results.back().present_happy, results.back().absent_happy);
+    }
 
-        return {present_happy, absent_happy};
+    // 树型DP：没有下级时就是basecase，来的快乐值就是自己的快乐值，不来的快乐值就是0
+    int get_max_happy(const TreeArena& company, unsigned thread_num = 1) {
+        if (company.size() == 0) {
+            return 0;
+        }
+        Info happy = company.fold<Info>([&company](uint32_t index, const Info* subs, size_t count) {
+            int present_happy = company.values[index];  // 当stuff来的时候，快乐值初始为stuff的快乐值
+            int absent_happy = 0;  // 当stuff不来的时候，快乐值初始为0
+            for (size_t i = 0; i < count; i++) {
+                present_happy += subs[i].absent_happy;  // stuff来时，只需要加上下级员工不来时的最大值
+                absent_happy += max(subs[i].present_happy, subs[i].absent_happy);  // stuff不来时，需要加上下级员工来与不来之间的最大值
+            }
+            return Info(present_happy, absent_happy);
+        }, thread_num);
+        return max(happy.present_happy, happy.absent_happy);
     }
 };
 
@@ -313,7 +537,81 @@ public:
 };
 
 
-int main() {
+// 随机插入n个数得到的搜索二叉树
+Node* random_tree(size_t n, unsigned seed) {
+    mt19937 rng(seed);
+    Node* head = nullptr;
+    for (size_t i = 0; i < n; i++) {
+        int value = (int)(rng() % 1000000);
+        Node** slot = &head;
+        while (*slot != nullptr) {
+            slot = value < (*slot)->value ? &(*slot)->left : &(*slot)->right;
+        }
+        *slot = new Node(value);
+    }
+    return head;
+}
+
+// 比较直接遍历指针树、从指针树出发（复制进数组再fold）和在建好的数组中的树上直接fold：求二叉树的最大距离、员工树的最大快乐值
+void benchmark_tree_dp(size_t n) {
+    Node* head = random_tree(n, 23);
+    mt19937 rng(29);
+    vector<Stuff*> staff;  // 第i个员工的上级是前面随机的一个员工
+    for (size_t i = 0; i < n; i++) {
+        staff.push_back(new Stuff((int)(rng() % 100)));
+        if (i > 0) {
+            staff[rng() % i]->sub.push_back(staff[i]);
+        }
+    }
+    auto nanos = [](chrono::steady_clock::time_point start) {
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count() * 1e9;
+    };
+    cout << "nodes = " << n << " (ns/node)" << endl;
+
+    auto start = chrono::steady_clock::now();
+    int pointer_result = MaxDistance(head).get_max_distance_no_recur();
+    double pointer_time = nanos(start);
+    start = chrono::steady_clock::now();
+    int copied_result = MaxDistance(head).get_max_distance();
+    double copied_time = nanos(start);
+    start = chrono::steady_clock::now();
+    TreeArena tree(head);
+    double build_time = nanos(start);
+    MaxDistance distance(tree);
+    start = chrono::steady_clock::now();
+    int arena_result = distance.get_max_distance(1);
+    double arena_time = nanos(start);
+    start = chrono::steady_clock::now();
+    bool same = copied_result == pointer_result && arena_result == pointer_result && distance.get_max_distance(0) == pointer_result;
+    double parallel_time = nanos(start);
+    cout << "max distance: pointer walk " << pointer_time / n << ", from pointers " << copied_time / n << ", arena build " << build_time / n
+         << ", fold " << arena_time / n << ", parallel fold " << parallel_time / n << (same ? "" : " (wrong)") << endl;
+
+    Party party;
+    start = chrono::steady_clock::now();
+    pointer_result = party.get_max_happy_no_recur(staff[0]);
+    pointer_time = nanos(start);
+    start = chrono::steady_clock::now();
+    copied_result = party.get_max_happy(staff[0]);
+    copied_time = nanos(start);
+    start = chrono::steady_clock::now();
+    TreeArena company(staff[0]);
+    build_time = nanos(start);
+    start = chrono::steady_clock::now();
+    arena_result = party.get_max_happy(company, 1);
+    arena_time = nanos(start);
+    start = chrono::steady_clock::now();
+    same = copied_result == pointer_result && arena_result == pointer_result && party.get_max_happy(company, 0) == pointer_result;
+    parallel_time = nanos(start);
+    cout << "max happy: pointer walk " << pointer_time / n << ", from pointers " << copied_time / n << ", arena build " << build_time / n
+         << ", fold " << arena_time / n << ", parallel fold " << parallel_time / n << (same ? "" : " (wrong)") << endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "bench") {
+        benchmark_tree_dp(argc > 2 ? (size_t)atoll(argv[2]) : 1000000);
+        return 0;
+    }
     Node* one = new Node(1);
     Node* two = new Node(2);
     Node* three = new Node(3);
@@ -87,4 +87,7 @@
  *      遍历完文件之后，堆中所留着的M个数字就是文件中最小的M个数字，将其输出。
  *      第二次遍历时，由于是大根堆，所以我们只统计大于上一次遍历结束后大根堆堆顶元素的数字即可。
  *
+ *      【方法三】外排序。每次读入内存能放下的一段数据排好序，写成一个有序的临时文件（顺串），然后用败者树对所有顺串做多路归并，
+ *      顺串太多时先分组归并成更长的顺串。只需要遍历文件常数次，代码见 **sort.cpp** 中的external_sort
+ *
  */
\ No newline at end of file